@@ -1,86 +1,65 @@
 #include "app.h"
+#include "ghost_kernel.h"
+#include "leaderboard.h"
 #include "platform.h"
+#include "telemetry.h"
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
 
-// Colors for the terminal
-#define ESC "\033"
-#define COLOR_RESET   ESC "[0m"
-#define COLOR_BOLD    ESC "[1m"
-#define COLOR_YELLOW  ESC "[33m"
-#define COLOR_RED     ESC "[31m"
-#define COLOR_BLUE    ESC "[34m"
-#define COLOR_WHITE   ESC "[37m"
-#define COLOR_CYAN    ESC "[36m"
-#define COLOR_GREEN   ESC "[32m"
-#define COLOR_MAGENTA ESC "[35m"
-
-// The maze layout
-const char *LEVEL_TEMPLATE[MAP_HEIGHT] = {
-    "########################################",
-    "#.........#..........#..........#......#",
-    "#.###.###.#.###.####.#.####.###.#.###..#",
-    "#.....#.....#...#....#....#...#.....#..#",
-    "#####.#.#####.#.#.##.#.##.#.#.#####.#.##",
-    "#.....#.......#.#.##.#.##.#.#.......#..#",
-    "#.#########.###.#....#....#.###.#######.#",
-    "#.............#.#.##.#.##.#.#...........#",
-    "#.###.#######.#.#.##.#.##.#.#.#######.###",
-    "#...#.#.......#.#....#....#.#.......#...#",
-    "#.#.#.#.#######.######.######.#######.#.#",
-    "#.#.#.#.........#....#........#.......#.#",
-    "#.#.#.###########.##.#.########.#######.#",
-    "#.#.....................................#",
-    "########################################",
-};
-
-// Copy the level template to the game map
-void copy_level(char map[MAP_HEIGHT][MAP_WIDTH + 1]) {
-    int r;
-    for (r = 0; r < MAP_HEIGHT; r++) {
-        strncpy(map[r], LEVEL_TEMPLATE[r], MAP_WIDTH + 1);
-        map[r][MAP_WIDTH] = '\0';
-    }
+// Copy the level's starting dots into the session
+void copy_level(struct App *app) {
+    memcpy(app_dots(app), app->level->dots, (size_t)app->level->words * sizeof(uint64_t));
+    app->dots_remaining = app->level->dot_count;
+    app->dots_first = UINT32_MAX;
+    app->dots_last = 0;
 }
 
-// Count dots remaining on the map
-unsigned int count_dots(const char map[MAP_HEIGHT][MAP_WIDTH + 1]) {
-    unsigned int dots = 0;
-    int r, c;
-    for (r = 0; r < MAP_HEIGHT; r++) {
-        for (c = 0; c < MAP_WIDTH; c++) {
-            if (map[r][c] == '.') {
-                dots = dots + 1;
-            }
-        }
+// Put back only the dots eaten since the last copy. A game restarted
+// early on a big maze has touched a few words of its bit set, not all.
+void restore_level(struct App *app) {
+    if (app->dots_first <= app->dots_last) {
+        memcpy(app_dots(app) + app->dots_first, app->level->dots + app->dots_first,
+               (size_t)(app->dots_last - app->dots_first + 1) * sizeof(uint64_t));
     }
-    return dots;
+    app->dots_remaining = app->level->dot_count;
+    app->dots_first = UINT32_MAX;
+    app->dots_last = 0;
 }
 
 // Check if a position is walkable (not a wall)
 bool is_walkable(const struct App *app, int row, int col) {
-    if (row < 0 || row >= MAP_HEIGHT || col < 0 || col >= MAP_WIDTH) {
+    const struct Level *level = app->level;
+    if (row < 0 || row >= level->rows || col < 0 || col >= level->cols) {
         return false;
     }
-    char c = app->map[row][col];
-    if (c == '#') {
-        return false;
+    return level_is_wall(level, row, col) == false;
+}
+
+// Play a sound unless this session runs without a screen
+void app_play_sound(const struct App *app, SoundType type) {
+    if ((app->flags & APP_HEADLESS) == 0) {
+        platform_play_sound(type);
+    }
+}
+
+// Post the final score to the leaderboard unless this session runs
+// without a screen
+void app_submit_score(const struct App *app) {
+    if ((app->flags & APP_HEADLESS) == 0) {
+        leaderboard_submit(app->score);
     }
-    return true;
 }
 
 // Reset pac-man and ghosts to starting positions
 void reset_positions(struct App *app) {
     int i;
-    app->pacman.row = app->pacman_start.row;
-    app->pacman.col = app->pacman_start.col;
+    app->pacman = app->level->pacman_start;
     app->pacman_dir = 0;
     for (i = 0; i < NUM_GHOSTS; i++) {
-        app->ghosts[i].pos.row = app->ghosts[i].start.row;
-        app->ghosts[i].pos.col = app->ghosts[i].start.col;
+        app->ghosts[i].pos = app->level->ghost_start[i];
         app->ghosts[i].last_dir = -1;
     }
 }
@@ -110,11 +89,17 @@ void move_pacman(struct App *app, int dr, int dc) {
     }
 
     // Eat dot if there is one
-    if (app->map[nr][nc] == '.') {
-        app->map[nr][nc] = ' ';
+    int cell = level_cell(app->level, nr, nc);
+    uint64_t *dots = app_dots(app);
+    if (level_bit(dots, cell)) {
+        uint32_t word = (uint32_t)(cell >> 6);
+        dots[word] &= ~((uint64_t)1 << (cell & 63));
+        if (word < app->dots_first) app->dots_first = word;
+        if (word > app->dots_last) app->dots_last = word;
         app->score = app->score + 1;
         app->dots_remaining = app->dots_remaining - 1;
-        platform_play_sound(SOUND_EAT_DOT);
+        app_play_sound(app, SOUND_EAT_DOT);
+        telemetry_record(TELEMETRY_DOT, app->id, app->timers.now, nr, nc, TELEMETRY_NONE, TELEMETRY_NONE);
         
         // Update high score
         if (app->score > app->high_score) {
@@ -123,22 +108,6 @@ void move_pacman(struct App *app, int dr, int dc) {
     }
 }
 
-// Calculate distance between two points (Manhattan distance)
-int get_distance(int r1, int c1, int r2, int c2) {
-    int dr = r1 - r2;
-    int dc = c1 - c2;
-    
-    // Get absolute values
-    if (dr < 0) {
-        dr = -dr;
-    }
-    if (dc < 0) {
-        dc = -dc;
-    }
-    
-    return dr + dc;
-}
-
 // Get opposite direction to avoid going back
 int get_opposite_dir(int dir) {
     if (dir == 0) return 1;  // up -> down
@@ -148,167 +117,287 @@ int get_opposite_dir(int dir) {
     return -1;
 }
 
-// Move a single ghost
-void move_single_ghost(struct App *app, struct Ghost *ghost) {
-    // Direction offsets: up, down, left, right
-    int dir_row[4] = {-1, 1, 0, 0};
-    int dir_col[4] = {0, 0, -1, 1};
-    
-    int valid_dirs[4];
+const struct GhostParams GHOST_PARAMS_DEFAULT = {
+    {
+        {0, 0, 100, 0},  // Red ghost: chase pac-man directly
+        {4, 0, 100, 0},  // Pink ghost: try to get ahead of pac-man
+        {0, 3, 100, 0},  // Cyan ghost: try to come from the side
+        {0, 0, 30, 0},   // Orange ghost: mostly random with some chasing
+    },
+    GAME_TICK_MS,
+    0,
+    0,
+    AI_DETAIL_FULL,
+    0,
+    30,  // Half the largest view, so every ghost on screen is near
+    80,
+};
+
+bool ghost_params_parse_detail(struct GhostParams *params, const char *text) {
+    int budget;
+
+    if (strcmp(text, "full") == 0) {
+        params->detail = AI_DETAIL_FULL;
+        params->detail_budget = 0;
+        return true;
+    }
+    if (sscanf(text, "fixed:%d", &budget) == 1 && budget >= 0) {
+        params->detail = AI_DETAIL_FIXED;
+        params->detail_budget = budget;
+        return true;
+    }
+    if (sscanf(text, "timed:%d", &budget) == 1 && budget >= 0) {
+        params->detail = AI_DETAIL_TIMED;
+        params->detail_budget = budget;
+        return true;
+    }
+    return false;
+}
+
+// Timer bits of every ghost
+#define GHOST_TIMERS (((1u << NUM_GHOSTS) - 1) << TIMER_GHOST)
+
+// Milliseconds to whole ticks (at least one)
+uint32_t ms_to_ticks(int ms) {
+    int ticks = (ms + APP_TICK_MS / 2) / APP_TICK_MS;
+    return ticks > 0 ? (uint32_t)ticks : 1;
+}
+
+uint32_t ghost_period(const struct App *app, const struct Ghost *ghost) {
+    int ms = app->params->behaviours[ghost->type].move_ms;
+    return ms_to_ticks(ms > 0 ? ms : app->params->tick_ms);
+}
+
+// Start every timer from scratch (new game or restart)
+void schedule_timers(struct App *app) {
+    int i;
+
+    timer_wheel_init(&app->timers);
+    if (app->params->pacman_ms > 0) {
+        timer_wheel_schedule(&app->timers, TIMER_PACMAN, ms_to_ticks(app->params->pacman_ms));
+    }
+    for (i = 0; i < NUM_GHOSTS; i++) {
+        if (i != app->player_ghost) {
+            timer_wheel_schedule(&app->timers, TIMER_GHOST + i, ghost_period(app, &app->ghosts[i]));
+        }
+    }
+}
+
+// Next random number for this session (xorshift32)
+uint32_t app_random(struct App *app) {
+    uint32_t x = app->rng;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    app->rng = x;
+    return x;
+}
+
+void app_seed(struct App *app, uint32_t seed) {
+    // xorshift gets stuck on 0, and nearby seeds should still differ
+    app->rng = seed * 2654435761u + 0x9e3779b9u;
+    if (app->rng == 0) {
+        app->rng = 1;
+    }
+}
+
+// Get the allowed directions for a ghost as a bit mask (bit d = direction d)
+int get_ghost_dirs(const struct App *app, const struct Ghost *ghost) {
+    int valid_mask = 0;
     int valid_count = 0;
     int i;
-    
+
     // Find all valid directions (not walls)
     for (i = 0; i < 4; i++) {
-        int nr = ghost->pos.row + dir_row[i];
-        int nc = ghost->pos.col + dir_col[i];
-        if (nr >= 0 && nr < MAP_HEIGHT && nc >= 0 && nc < MAP_WIDTH) {
-            if (app->map[nr][nc] != '#') {
-                valid_dirs[valid_count] = i;
-                valid_count = valid_count + 1;
-            }
+        if (is_walkable(app, ghost->pos.row + GHOST_DIR_ROW[i], ghost->pos.col + GHOST_DIR_COL[i])) {
+            valid_mask = valid_mask | (1 << i);
+            valid_count = valid_count + 1;
         }
     }
-    
-    if (valid_count == 0) {
-        return;
-    }
-    
+
     // Try not to go backwards
     int opposite = get_opposite_dir(ghost->last_dir);
-    int filtered_dirs[4];
-    int filtered_count = 0;
-    
-    for (i = 0; i < valid_count; i++) {
-        if (valid_dirs[i] != opposite || valid_count == 1) {
-            filtered_dirs[filtered_count] = valid_dirs[i];
-            filtered_count = filtered_count + 1;
-        }
+    if (valid_count > 1 && opposite >= 0) {
+        valid_mask = valid_mask & ~(1 << opposite);
     }
-    
-    int chosen_dir = -1;
-    int target_row = app->pacman.row;
-    int target_col = app->pacman.col;
-    
-    // Different behavior based on ghost type
-    if (ghost->type == GHOST_CHASER) {
-        // Red ghost: chase pac-man directly
-        int best_dist = 9999;
-        for (i = 0; i < filtered_count; i++) {
-            int d = filtered_dirs[i];
-            int nr = ghost->pos.row + dir_row[d];
-            int nc = ghost->pos.col + dir_col[d];
-            int dist = get_distance(nr, nc, target_row, target_col);
-            if (dist < best_dist) {
-                best_dist = dist;
-                chosen_dir = d;
-            }
-        }
-    }
-    else if (ghost->type == GHOST_AMBUSHER) {
-        // Pink ghost: try to get ahead of pac-man
-        int ahead_row[4] = {-4, 4, 0, 0};
-        int ahead_col[4] = {0, 0, -4, 4};
-        
-        int aim_r = target_row + ahead_row[app->pacman_dir];
-        int aim_c = target_col + ahead_col[app->pacman_dir];
-        
-        // Keep in bounds
-        if (aim_r < 0) aim_r = 0;
-        if (aim_r >= MAP_HEIGHT) aim_r = MAP_HEIGHT - 1;
-        if (aim_c < 0) aim_c = 0;
-        if (aim_c >= MAP_WIDTH) aim_c = MAP_WIDTH - 1;
-        
-        int best_dist = 9999;
-        for (i = 0; i < filtered_count; i++) {
-            int d = filtered_dirs[i];
-            int nr = ghost->pos.row + dir_row[d];
-            int nc = ghost->pos.col + dir_col[d];
-            int dist = get_distance(nr, nc, aim_r, aim_c);
-            if (dist < best_dist) {
-                best_dist = dist;
-                chosen_dir = d;
-            }
-        }
+    return valid_mask;
+}
+
+// Fill in one ghost's slot in the batch: where it is, where it is
+// heading and which directions it may take
+void plan_ghost_move(struct App *app, const struct Ghost *ghost, struct GhostBatch *batch) {
+    const struct GhostBehaviour *behaviour = &app->params->behaviours[ghost->type];
+    int slot = batch->count;
+    int dirs = get_ghost_dirs(app, ghost);
+    int d;
+
+    batch->row[slot] = ghost->pos.row;
+    batch->col[slot] = ghost->pos.col;
+    batch->dir_mask[slot] = dirs;
+    batch->count = batch->count + 1;
+
+    if (dirs == 0) {
+        batch->target_row[slot] = ghost->pos.row;
+        batch->target_col[slot] = ghost->pos.col;
+        return;
     }
-    else if (ghost->type == GHOST_FLANKER) {
-        // Cyan ghost: try to come from the side
-        int flank_r = target_row;
-        int flank_c = target_col;
-        
+
+    int target_row = app->pacman.row + behaviour->lookahead * GHOST_DIR_ROW[app->pacman_dir];
+    int target_col = app->pacman.col + behaviour->lookahead * GHOST_DIR_COL[app->pacman_dir];
+
+    if (behaviour->flank != 0) {
         if (app->pacman_dir == 0 || app->pacman_dir == 1) {
             // Pac-man moving up/down, flank from side
-            if (ghost->pos.col > target_col) {
-                flank_c = flank_c + 3;
+            if (ghost->pos.col > app->pacman.col) {
+                target_col = target_col + behaviour->flank;
             } else {
-                flank_c = flank_c - 3;
+                target_col = target_col - behaviour->flank;
             }
         } else {
             // Pac-man moving left/right, flank from above/below
-            if (ghost->pos.row > target_row) {
-                flank_r = flank_r + 3;
+            if (ghost->pos.row > app->pacman.row) {
+                target_row = target_row + behaviour->flank;
             } else {
-                flank_r = flank_r - 3;
+                target_row = target_row - behaviour->flank;
             }
         }
-        
-        // Keep in bounds
-        if (flank_r < 0) flank_r = 0;
-        if (flank_r >= MAP_HEIGHT) flank_r = MAP_HEIGHT - 1;
-        if (flank_c < 0) flank_c = 0;
-        if (flank_c >= MAP_WIDTH) flank_c = MAP_WIDTH - 1;
-        
-        int best_dist = 9999;
-        for (i = 0; i < filtered_count; i++) {
-            int d = filtered_dirs[i];
-            int nr = ghost->pos.row + dir_row[d];
-            int nc = ghost->pos.col + dir_col[d];
-            int dist = get_distance(nr, nc, flank_r, flank_c);
-            if (dist < best_dist) {
-                best_dist = dist;
-                chosen_dir = d;
+    }
+
+    // Keep in bounds
+    if (target_row < 0) target_row = 0;
+    if (target_row >= app->level->rows) target_row = app->level->rows - 1;
+    if (target_col < 0) target_col = 0;
+    if (target_col >= app->level->cols) target_col = app->level->cols - 1;
+
+    batch->target_row[slot] = target_row;
+    batch->target_col[slot] = target_col;
+
+    if (behaviour->chase_percent < 100) {
+        int random_chance = (int)(app_random(app) % 100);
+        if (random_chance >= behaviour->chase_percent) {
+            // Random movement: only allow one of the directions
+            int dir_count = 0;
+            for (d = 0; d < 4; d++) {
+                dir_count = dir_count + ((dirs >> d) & 1);
+            }
+            int random_index = (int)(app_random(app) % (uint32_t)dir_count);
+            for (d = 0; d < 4; d++) {
+                if ((dirs >> d) & 1) {
+                    if (random_index == 0) {
+                        batch->dir_mask[slot] = 1 << d;
+                        break;
+                    }
+                    random_index = random_index - 1;
+                }
             }
         }
     }
-    else {
-        // Orange ghost: mostly random with some chasing
-        int random_chance = rand() % 100;
-        
-        if (random_chance < 30) {
-            // 30% chance to chase
-            int best_dist = 9999;
-            for (i = 0; i < filtered_count; i++) {
-                int d = filtered_dirs[i];
-                int nr = ghost->pos.row + dir_row[d];
-                int nc = ghost->pos.col + dir_col[d];
-                int dist = get_distance(nr, nc, target_row, target_col);
-                if (dist < best_dist) {
-                    best_dist = dist;
-                    chosen_dir = d;
-                }
+}
+
+// Cheap decision for a ghost far from pac-man: keep going the same way
+// if it can, otherwise head for pac-man's tile. No lookahead, flanking or
+// random rolls.
+void plan_cheap_ghost_move(struct App *app, const struct Ghost *ghost, struct GhostBatch *batch) {
+    int slot = batch->count;
+    int dirs = get_ghost_dirs(app, ghost);
+
+    batch->row[slot] = ghost->pos.row;
+    batch->col[slot] = ghost->pos.col;
+    batch->target_row[slot] = app->pacman.row;
+    batch->target_col[slot] = app->pacman.col;
+    batch->dir_mask[slot] = dirs;
+    if (ghost->last_dir >= 0 && ((dirs >> ghost->last_dir) & 1)) {
+        batch->dir_mask[slot] = 1 << ghost->last_dir;
+    }
+    batch->count = batch->count + 1;
+}
+
+bool ghost_is_near(const struct App *app, const struct Ghost *ghost) {
+    return abs(ghost->pos.row - app->pacman.row) <= app->params->near_rows &&
+           abs(ghost->pos.col - app->pacman.col) <= app->params->near_cols;
+}
+
+// Add the ghosts whose timers fired (bit TIMER_GHOST + i) to the plan,
+// which must have room for NUM_GHOSTS more
+void app_plan_ghosts(struct GhostPlan *plan, struct App *app, uint32_t due) {
+    const struct GhostParams *params = app->params;
+    int budget = params->detail_budget;
+    long long deadline = 0;
+    int first = 0;
+    int n;
+
+    if (params->detail == AI_DETAIL_TIMED) {
+        deadline = platform_time_ns() + (long long)budget * 1000;
+    }
+    // Far ghosts take turns at getting the budget first
+    if (params->detail != AI_DETAIL_FULL) {
+        first = (int)(app->timers.now % NUM_GHOSTS);
+    }
+
+    for (n = 0; n < NUM_GHOSTS; n++) {
+        int i = (first + n) % NUM_GHOSTS;
+        const struct Ghost *ghost = &app->ghosts[i];
+        if ((due & (1u << (TIMER_GHOST + i))) == 0) {
+            continue;
+        }
+
+        bool cheap = false;
+        if (params->detail != AI_DETAIL_FULL && ghost_is_near(app, ghost) == false) {
+            if (params->detail == AI_DETAIL_FIXED) {
+                cheap = budget <= 0;
+                budget = budget - 1;
+            } else {
+                cheap = platform_time_ns() >= deadline;
             }
+        }
+
+        plan->app[plan->batch.count] = app;
+        plan->ghost[plan->batch.count] = i;
+        plan->cheap[plan->batch.count] = cheap;
+        if (cheap) {
+            plan_cheap_ghost_move(app, ghost, &plan->batch);
         } else {
-            // 70% random movement
-            int random_index = rand() % filtered_count;
-            chosen_dir = filtered_dirs[random_index];
+            plan_ghost_move(app, ghost, &plan->batch);
         }
     }
-    
-    // Move the ghost
-    if (chosen_dir >= 0) {
-        ghost->pos.row = ghost->pos.row + dir_row[chosen_dir];
-        ghost->pos.col = ghost->pos.col + dir_col[chosen_dir];
-        ghost->last_dir = chosen_dir;
-        app->needs_redraw = true;
-    }
 }
 
-// Move all ghosts
-void move_ghosts(struct App *app) {
-    int i;
-    for (i = 0; i < NUM_GHOSTS; i++) {
-        move_single_ghost(app, &app->ghosts[i]);
+// Score every planned ghost in one go, move them, set their timers again
+// and empty the plan
+void app_move_planned_ghosts(struct GhostPlan *plan) {
+    int slot;
+
+    ghost_kernel_score(&plan->batch);
+
+    for (slot = 0; slot < plan->batch.count; slot++) {
+        struct App *app = plan->app[slot];
+        struct Ghost *ghost = &app->ghosts[plan->ghost[slot]];
+        int chosen_dir = plan->batch.chosen[slot];
+        if (chosen_dir >= 0) {
+            ghost->pos.row = ghost->pos.row + GHOST_DIR_ROW[chosen_dir];
+            ghost->pos.col = ghost->pos.col + GHOST_DIR_COL[chosen_dir];
+            ghost->last_dir = chosen_dir;
+            app->needs_redraw = true;
+        }
+        if (plan->cheap[slot]) {
+            app->ai_cheap = app->ai_cheap + 1;
+        } else {
+            app->ai_full = app->ai_full + 1;
+        }
+        telemetry_record(plan->cheap[slot] ? TELEMETRY_GHOST_CHEAP_MOVE : TELEMETRY_GHOST_MOVE,
+                         app->id, app->timers.now, ghost->pos.row, ghost->pos.col,
+                         ghost->type, chosen_dir >= 0 ? chosen_dir : TELEMETRY_NONE);
+        timer_wheel_schedule(&app->timers, TIMER_GHOST + plan->ghost[slot], ghost_period(app, ghost));
     }
+    plan->batch.count = 0;
+}
+
+// Move one session's ghosts whose timers fired
+void move_ghosts(struct App *app, uint32_t due) {
+    struct GhostPlan plan;
+    plan.batch.count = 0;
+    app_plan_ghosts(&plan, app, due);
+    app_move_planned_ghosts(&plan);
 }
 
 // Check if pac-man hit a ghost
@@ -319,16 +408,27 @@ void check_collision(struct App *app) {
             app->pacman.col == app->ghosts[i].pos.col) {
             
             app->lives = app->lives - 1;
+            telemetry_record(TELEMETRY_LIFE_LOST, app->id, app->timers.now, app->pacman.row, app->pacman.col,
+                             app->ghosts[i].type, TELEMETRY_NONE);
             
             if (app->lives == 0) {
                 app->game_over = true;
-                platform_play_sound(SOUND_GAME_OVER);
-                if (app->score > 0) {
-                    platform_save_highscore(app->high_score);
-                }
+                telemetry_record(TELEMETRY_GAME_OVER, app->id, app->timers.now, app->pacman.row, app->pacman.col,
+                                 app->ghosts[i].type, TELEMETRY_NONE);
+                app_play_sound(app, SOUND_GAME_OVER);
+                app_submit_score(app);
             } else {
-                platform_play_sound(SOUND_LOSE_LIFE);
+                app_play_sound(app, SOUND_LOSE_LIFE);
                 reset_positions(app);
+
+                // Give pac-man a head start: hold the ghosts until the
+                // respawn timer fires
+                if (app->params->respawn_ms > 0) {
+                    for (i = 0; i < NUM_GHOSTS; i++) {
+                        timer_wheel_cancel(&app->timers, TIMER_GHOST + i);
+                    }
+                    timer_wheel_schedule(&app->timers, TIMER_RESPAWN, ms_to_ticks(app->params->respawn_ms));
+                }
             }
             app->needs_redraw = true;
             return;
@@ -336,221 +436,254 @@ void check_collision(struct App *app) {
     }
 }
 
+size_t app_session_size(const struct Level *level) {
+    size_t size = sizeof(struct App) + (size_t)level->words * sizeof(uint64_t);
+    return (size + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE * CACHE_LINE_SIZE;
+}
+
+// Set up a session in memory the caller owns (app_session_size bytes)
+void app_init(struct App *app, const struct Level *level, int flags) {
+    int i;
+
+    memset(app, 0, sizeof(*app));
+    app->level = level;
+    app->params = &GHOST_PARAMS_DEFAULT;
+    app->flags = flags;
+    app_seed(app, 1);
+    app->lives = 3;
+    app->max_lives = 3;
+    app->running = true;
+    app->needs_redraw = true;
+    app->player_ghost = -1;
+
+    // Ghost types go in the same order as the level's ghost spawns
+    for (i = 0; i < NUM_GHOSTS; i++) {
+        app->ghosts[i].type = i % 4;
+        app->ghosts[i].last_dir = -1;
+    }
+
+    copy_level(app);
+    reset_positions(app);
+    schedule_timers(app);
+}
+
+// Start the level again in place. The score, lives, dots and everyone's
+// positions go back to the start; the seed, high score and settings stay.
+void app_restart(struct App *app) {
+    restore_level(app);
+    app->score = 0;
+    app->lives = app->max_lives;
+    app->won = false;
+    app->game_over = false;
+    app->running = true;
+    reset_positions(app);
+    schedule_timers(app);
+    app->needs_redraw = true;
+}
+
+void app_set_params(struct App *app, const struct GhostParams *params) {
+    app->params = params;
+    schedule_timers(app);
+}
+
 // Create and initialize the game
-struct App app_create() {
-    struct App app;
-    
-    srand((unsigned int)time(NULL));
-    
-    // Load saved high score
-    unsigned int saved_high_score = platform_load_highscore();
-    
-    // Initialize all the variables
-    app.score = 0;
-    app.high_score = saved_high_score;
-    app.lives = 3;
-    app.max_lives = 3;
-    app.dots_remaining = 0;
-    app.running = true;
-    app.won = false;
-    app.game_over = false;
-    app.needs_redraw = true;
-    app.pacman_start.row = 13;
-    app.pacman_start.col = 20;
-    app.pacman_dir = 0;
-    app.term_rows = 24;
-    app.term_cols = 80;
-    
-    platform_play_sound(SOUND_START);
-    
-    // Setup red ghost (chaser) - top left
-    app.ghosts[0].start.row = 1;
-    app.ghosts[0].start.col = 1;
-    app.ghosts[0].type = GHOST_CHASER;
-    app.ghosts[0].last_dir = -1;
-    
-    // Setup pink ghost (ambusher) - top right
-    app.ghosts[1].start.row = 1;
-    app.ghosts[1].start.col = 38;
-    app.ghosts[1].type = GHOST_AMBUSHER;
-    app.ghosts[1].last_dir = -1;
-    
-    // Setup cyan ghost (flanker) - center
-    app.ghosts[2].start.row = 7;
-    app.ghosts[2].start.col = 20;
-    app.ghosts[2].type = GHOST_FLANKER;
-    app.ghosts[2].last_dir = -1;
-    
-    // Setup orange ghost (random) - bottom
-    app.ghosts[3].start.row = 11;
-    app.ghosts[3].start.col = 10;
-    app.ghosts[3].type = GHOST_RANDOM;
-    app.ghosts[3].last_dir = -1;
-    
-    copy_level(app.map);
-    app.dots_remaining = count_dots(app.map);
-    reset_positions(&app);
-    platform_get_terminal_size(&app.term_rows, &app.term_cols);
-    
+struct App *app_create(const struct Level *level) {
+    struct App *app = platform_aligned_alloc(CACHE_LINE_SIZE, app_session_size(level));
+    if (app == NULL) {
+        return NULL;
+    }
+
+    app_init(app, level, 0);
+    app_seed(app, (uint32_t)time(NULL));
+
     return app;
 }
 
-void app_destroy(struct App *app) {
-    if (app != NULL) {
-        app->running = false;
+// Opening the leaderboard maps a file and starts its flush thread, so
+// this is left until after the first frame is on screen.
+void app_load_high_score(struct App *app) {
+    unsigned int best = leaderboard_best();
+    if (best > app->high_score) {
+        app->high_score = best;
     }
+    app->needs_redraw = true;
 }
 
-// Draw the game on screen
-void app_render(struct App *app) {
-    int r, c, i, g;
-    
-    if (app->needs_redraw == false) {
-        return;
-    }
-    app->needs_redraw = false;
+void app_destroy(struct App *app) {
+    platform_aligned_free(app);
+}
 
-    platform_get_terminal_size(&app->term_rows, &app->term_cols);
+void renderer_init(struct Renderer *renderer, const struct ScreenCaps *caps) {
+    screen_init(&renderer->screen, caps);
+    renderer->layout_level = NULL;
+}
 
-    char *buf = app->frame_buffer;
-    char *p = buf;
+void renderer_resize(struct Renderer *renderer, int rows, int cols) {
+    renderer->term_rows = rows;
+    renderer->term_cols = cols;
+    renderer->layout_level = NULL;
+    screen_invalidate(&renderer->screen);
+}
 
-    // Clear screen
-    p = p + sprintf(p, "\033[2J\033[H");
+void renderer_invalidate(struct Renderer *renderer) {
+    screen_invalidate(&renderer->screen);
+}
 
-    // Calculate padding to center the game
-    int content_h = MAP_HEIGHT + 8;
-    int content_w = MAP_WIDTH + 4;
-    int pad_top = (app->term_rows - content_h) / 2;
-    int pad_left = (app->term_cols - content_w) / 2;
+// Work out where the game sits on screen. Only needed again when the
+// terminal or the level changes size.
+void renderer_layout(struct Renderer *renderer, const struct Level *level) {
+    // Show as much of the maze as the terminal has room for
+    int view_rows = level->rows;
+    int view_cols = level->cols;
+    if (view_rows > renderer->term_rows - 8) view_rows = renderer->term_rows - 8;
+    if (view_cols > renderer->term_cols - 4) view_cols = renderer->term_cols - 4;
+    if (view_rows > RENDER_MAX_VIEW_ROWS) view_rows = RENDER_MAX_VIEW_ROWS;
+    if (view_cols > RENDER_MAX_VIEW_COLS) view_cols = RENDER_MAX_VIEW_COLS;
+    if (view_rows < MAP_HEIGHT) view_rows = level->rows < MAP_HEIGHT ? level->rows : MAP_HEIGHT;
+    if (view_cols < MAP_WIDTH) view_cols = level->cols < MAP_WIDTH ? level->cols : MAP_WIDTH;
+
+    int content_h = view_rows + 8;
+    int content_w = view_cols + 4;
+    int pad_top = (renderer->term_rows - content_h) / 2;
+    int pad_left = (renderer->term_cols - content_w) / 2;
     if (pad_top < 0) pad_top = 0;
     if (pad_left < 0) pad_left = 0;
 
-    // Add top padding
-    for (i = 0; i < pad_top; i++) {
-        *p = '\n';
-        p = p + 1;
+    renderer->view_rows = view_rows;
+    renderer->view_cols = view_cols;
+    renderer->pad_top = pad_top;
+    renderer->pad_left = pad_left;
+    renderer->layout_level = level;
+}
+
+// Put a number at row/col. Returns the column after it.
+int put_number(struct Screen *screen, int row, int col, int style, unsigned int value) {
+    char text[16];
+    snprintf(text, sizeof(text), "%u", value);
+    return screen_text(screen, row, col, style, text);
+}
+
+int app_render(const struct App *app, struct Renderer *renderer) {
+    const struct Level *level = app->level;
+    struct Screen *screen = &renderer->screen;
+    int r, c, g, col;
+
+    if (renderer->layout_level != level) {
+        renderer_layout(renderer, level);
     }
 
+    // Keep pac-man in the middle of the view, stopping at the maze edges
+    int top = app->pacman.row - renderer->view_rows / 2;
+    int left = app->pacman.col - renderer->view_cols / 2;
+    if (top > level->rows - renderer->view_rows) top = level->rows - renderer->view_rows;
+    if (left > level->cols - renderer->view_cols) left = level->cols - renderer->view_cols;
+    if (top < 0) top = 0;
+    if (left < 0) left = 0;
+
+    // Title, score, controls and the top line, then the map from row 4
+    screen_begin(screen, renderer->pad_top, renderer->pad_left, renderer->view_rows + 7,
+                 renderer->term_cols - renderer->pad_left);
+    int map_row = 4;
+    int bottom_row = map_row + renderer->view_rows;
+
     // Title
-    for (i = 0; i < pad_left; i++) {
-        *p = ' ';
-        p = p + 1;
-    }
-    p = p + sprintf(p, COLOR_BOLD COLOR_MAGENTA "================= PAC-MAN =================" COLOR_RESET "\n");
+    screen_text(screen, 0, 0, STYLE_BOLD | STYLE_MAGENTA, "================= PAC-MAN =================");
 
     // Score and lives
-    for (i = 0; i < pad_left; i++) {
-        *p = ' ';
-        p = p + 1;
-    }
-    p = p + sprintf(p, COLOR_CYAN " Score: " COLOR_BOLD COLOR_GREEN "%u" COLOR_RESET, app->score);
-    p = p + sprintf(p, COLOR_CYAN "  Hi: " COLOR_BOLD COLOR_YELLOW "%u" COLOR_RESET, app->high_score);
-    p = p + sprintf(p, COLOR_CYAN "  Lives: " COLOR_BOLD);
-    if (app->lives > 0) {
-        p = p + sprintf(p, COLOR_GREEN "%u" COLOR_RESET "/" COLOR_WHITE "%u", app->lives, app->max_lives);
-    } else {
-        p = p + sprintf(p, COLOR_RED "0" COLOR_RESET "/" COLOR_WHITE "%u", app->max_lives);
+    col = screen_text(screen, 1, 0, STYLE_CYAN, " Score: ");
+    col = put_number(screen, 1, col, STYLE_BOLD | STYLE_GREEN, app->score);
+    col = screen_text(screen, 1, col, STYLE_CYAN, "  Hi: ");
+    col = put_number(screen, 1, col, STYLE_BOLD | STYLE_YELLOW, app->high_score);
+    col = screen_text(screen, 1, col, STYLE_CYAN, "  Lives: ");
+    col = put_number(screen, 1, col, STYLE_BOLD | (app->lives > 0 ? STYLE_GREEN : STYLE_RED), app->lives);
+    col = screen_text(screen, 1, col, STYLE_PLAIN, "/");
+    col = put_number(screen, 1, col, STYLE_WHITE, app->max_lives);
+    col = screen_text(screen, 1, col, STYLE_CYAN, "  Dots: ");
+    col = put_number(screen, 1, col, STYLE_BOLD | STYLE_WHITE, app->dots_remaining);
+    if (level->number > 0) {
+        col = screen_text(screen, 1, col, STYLE_CYAN, "  Level: ");
+        put_number(screen, 1, col, STYLE_BOLD | STYLE_MAGENTA, (unsigned int)level->number);
     }
-    p = p + sprintf(p, COLOR_RESET COLOR_CYAN "  Dots: " COLOR_BOLD COLOR_WHITE "%u" COLOR_RESET "\n", app->dots_remaining);
 
     // Controls
-    for (i = 0; i < pad_left; i++) {
-        *p = ' ';
-        p = p + 1;
-    }
-    p = p + sprintf(p, COLOR_WHITE " WASD" COLOR_CYAN "=Move " COLOR_WHITE "R/Space" COLOR_CYAN "=Restart " COLOR_WHITE "Q" COLOR_CYAN "=Quit" COLOR_RESET "\n");
-
-    // Top line
-    for (i = 0; i < pad_left; i++) {
-        *p = ' ';
-        p = p + 1;
-    }
-    p = p + sprintf(p, COLOR_BLUE "------------------------------------------" COLOR_RESET "\n");
-
-    // Draw the map
-    for (r = 0; r < MAP_HEIGHT; r++) {
-        for (i = 0; i < pad_left; i++) {
-            *p = ' ';
-            p = p + 1;
-        }
-        *p = ' ';
-        p = p + 1;
-
-        for (c = 0; c < MAP_WIDTH; c++) {
-            // Check if pac-man is here
-            if (app->pacman.row == r && app->pacman.col == c) {
-                p = p + sprintf(p, COLOR_BOLD COLOR_YELLOW "C" COLOR_RESET);
-            } else {
-                // Check if any ghost is here
-                int ghost_here = -1;
-                for (g = 0; g < NUM_GHOSTS; g++) {
-                    if (app->ghosts[g].pos.row == r && app->ghosts[g].pos.col == c) {
-                        ghost_here = g;
-                        break;
-                    }
-                }
-                
-                if (ghost_here >= 0) {
-                    // Draw ghost with different colors
-                    if (app->ghosts[ghost_here].type == GHOST_CHASER) {
-                        p = p + sprintf(p, COLOR_BOLD COLOR_RED "G" COLOR_RESET);
-                    } else if (app->ghosts[ghost_here].type == GHOST_AMBUSHER) {
-                        p = p + sprintf(p, COLOR_BOLD COLOR_MAGENTA "G" COLOR_RESET);
-                    } else if (app->ghosts[ghost_here].type == GHOST_FLANKER) {
-                        p = p + sprintf(p, COLOR_BOLD COLOR_CYAN "G" COLOR_RESET);
-                    } else {
-                        p = p + sprintf(p, COLOR_BOLD COLOR_YELLOW "G" COLOR_RESET);
-                    }
-                } else {
-                    // Draw map tile
-                    char tile = app->map[r][c];
-                    if (tile == '#') {
-                        p = p + sprintf(p, COLOR_BLUE "#" COLOR_RESET);
-                    } else if (tile == '.') {
-                        p = p + sprintf(p, COLOR_WHITE "." COLOR_RESET);
-                    } else {
-                        *p = ' ';
-                        p = p + 1;
-                    }
-                }
+    col = screen_text(screen, 2, 0, STYLE_WHITE, " WASD");
+    col = screen_text(screen, 2, col, STYLE_CYAN, "=Move ");
+    col = screen_text(screen, 2, col, STYLE_WHITE, "R/Space");
+    col = screen_text(screen, 2, col, STYLE_CYAN, "=Restart ");
+    col = screen_text(screen, 2, col, STYLE_WHITE, "Q");
+    screen_text(screen, 2, col, STYLE_CYAN, "=Quit");
+
+    // Top and bottom lines
+    screen_text(screen, 3, 0, STYLE_BLUE, "------------------------------------------");
+    screen_text(screen, bottom_row, 0, STYLE_BLUE, "------------------------------------------");
+
+    // Draw the map. Wall shapes were worked out with the level, so joined
+    // up walls cost no more than plain ones.
+    const uint64_t *dots = app_dots_const(app);
+    for (r = 0; r < renderer->view_rows; r++) {
+        int cell = level_cell(level, top + r, left);
+        for (c = 0; c < renderer->view_cols; c++) {
+            if (level_bit(level->walls, cell)) {
+                screen_put(screen, map_row + r, 1 + c, GLYPH_WALL + level_wall_shape(level, cell), STYLE_WALL);
+            } else if (level_bit(dots, cell)) {
+                screen_put(screen, map_row + r, 1 + c, '.', STYLE_DOT);
             }
+            cell = cell + 1;
         }
-        *p = '\n';
-        p = p + 1;
     }
 
-    // Bottom line
-    for (i = 0; i < pad_left; i++) {
-        *p = ' ';
-        p = p + 1;
+    // Ghosts on top, the first one on top of the others, then pac-man
+    for (g = NUM_GHOSTS - 1; g >= 0; g--) {
+        r = app->ghosts[g].pos.row - top;
+        c = app->ghosts[g].pos.col - left;
+        if (r >= 0 && r < renderer->view_rows && c >= 0 && c < renderer->view_cols) {
+            screen_put(screen, map_row + r, 1 + c, 'G', STYLE_GHOST + app->ghosts[g].type);
+        }
     }
-    p = p + sprintf(p, COLOR_BLUE "------------------------------------------" COLOR_RESET "\n");
+    screen_put(screen, map_row + app->pacman.row - top, 1 + app->pacman.col - left, 'C', STYLE_PACMAN);
 
     // Status message at bottom
-    for (i = 0; i < pad_left; i++) {
-        *p = ' ';
-        p = p + 1;
-    }
-    if (app->won) {
-        p = p + sprintf(p, COLOR_BOLD COLOR_GREEN " *** MISSION COMPLETE! All dots cleared! ***" COLOR_RESET "\n");
+    if (app->won && level->number > 0) {
+        col = screen_text(screen, bottom_row + 1, 0, STYLE_BOLD | STYLE_GREEN, " *** LEVEL ");
+        col = put_number(screen, bottom_row + 1, col, STYLE_BOLD | STYLE_GREEN, (unsigned int)level->number);
+        screen_text(screen, bottom_row + 1, col, STYLE_BOLD | STYLE_GREEN, " CLEARED! Get ready for the next one ***");
+    } else if (app->won) {
+        screen_text(screen, bottom_row + 1, 0, STYLE_BOLD | STYLE_GREEN,
+                    " *** MISSION COMPLETE! All dots cleared! ***");
     } else if (app->game_over) {
-        p = p + sprintf(p, COLOR_BOLD COLOR_RED " ========== MISSION FAILED ========== " COLOR_RESET "\n");
-        for (i = 0; i < pad_left; i++) {
-            *p = ' ';
-            p = p + 1;
-        }
-        p = p + sprintf(p, COLOR_BOLD COLOR_YELLOW " Press SPACE or R to try again!" COLOR_RESET "\n");
+        screen_text(screen, bottom_row + 1, 0, STYLE_BOLD | STYLE_RED,
+                    " ========== MISSION FAILED ========== ");
+        screen_text(screen, bottom_row + 2, 0, STYLE_BOLD | STYLE_YELLOW, " Press SPACE or R to try again!");
     } else {
-        p = p + sprintf(p, COLOR_BOLD COLOR_YELLOW " C" COLOR_RESET "=Pac-Man ");
-        p = p + sprintf(p, COLOR_BOLD COLOR_RED "G" COLOR_RESET "=Chaser ");
-        p = p + sprintf(p, COLOR_BOLD COLOR_MAGENTA "G" COLOR_RESET "=Ambush ");
-        p = p + sprintf(p, COLOR_BOLD COLOR_CYAN "G" COLOR_RESET "=Flank ");
-        p = p + sprintf(p, COLOR_BOLD COLOR_YELLOW "G" COLOR_RESET "=Random\n");
-    }
+        col = screen_text(screen, bottom_row + 1, 1, STYLE_PACMAN, "C");
+        col = screen_text(screen, bottom_row + 1, col, STYLE_PLAIN, "=Pac-Man ");
+        col = screen_text(screen, bottom_row + 1, col, STYLE_GHOST + GHOST_CHASER, "G");
+        col = screen_text(screen, bottom_row + 1, col, STYLE_PLAIN, "=Chaser ");
+        col = screen_text(screen, bottom_row + 1, col, STYLE_GHOST + GHOST_AMBUSHER, "G");
+        col = screen_text(screen, bottom_row + 1, col, STYLE_PLAIN, "=Ambush ");
+        col = screen_text(screen, bottom_row + 1, col, STYLE_GHOST + GHOST_FLANKER, "G");
+        col = screen_text(screen, bottom_row + 1, col, STYLE_PLAIN, "=Flank ");
+        col = screen_text(screen, bottom_row + 1, col, STYLE_GHOST + GHOST_RANDOM, "G");
+        screen_text(screen, bottom_row + 1, col, STYLE_PLAIN, "=Random");
+    }
+
+    return screen_encode(screen, renderer->frame_buffer);
+}
 
-    // Write everything to screen at once
-    platform_write(buf, (int)(p - buf));
+// Check if pac-man has eaten every dot. A campaign run goes on to the
+// next level, so its score is only posted when the run ends: at game
+// over or when the player quits.
+void check_won(struct App *app) {
+    if (app->dots_remaining == 0 && app->won == false) {
+        app->won = true;
+        app->needs_redraw = true;
+        app_play_sound(app, SOUND_WIN);
+        telemetry_record(TELEMETRY_WIN, app->id, app->timers.now, app->pacman.row, app->pacman.col,
+                         TELEMETRY_NONE, TELEMETRY_NONE);
+        if (app->level->number == 0) {
+            app_submit_score(app);
+        }
+    }
 }
 
 // Handle keyboard input
@@ -561,22 +694,17 @@ void app_handle_input(struct App *app, int cmd) {
 
     // Quit game
     if (cmd == 'q' || cmd == 'Q') {
+        if (app->level->number > 0 && app->game_over == false) {
+            app_submit_score(app);
+        }
         app->running = false;
         return;
     }
 
     // Restart game
     if (cmd == 'r' || cmd == 'R' || cmd == ' ') {
-        copy_level(app->map);
-        app->dots_remaining = count_dots(app->map);
-        app->score = 0;
-        app->lives = app->max_lives;
-        app->won = false;
-        app->game_over = false;
-        app->running = true;
-        reset_positions(app);
-        app->needs_redraw = true;
-        platform_play_sound(SOUND_START);
+        app_restart(app);
+        app_play_sound(app, SOUND_START);
         return;
     }
 
@@ -597,29 +725,151 @@ void app_handle_input(struct App *app, int cmd) {
     }
 
     check_collision(app);
-    
-    // Check if player won
-    if (app->dots_remaining == 0) {
-        app->won = true;
-        app->needs_redraw = true;
-        platform_play_sound(SOUND_WIN);
-        platform_save_highscore(app->high_score);
-    }
+    check_won(app);
 }
 
-// Update game state (called every tick)
-void app_update(struct App *app) {
+// First part of a tick: the timers, the respawn delay and pac-man.
+// Returns the timers that fired, or 0 if the tick is over already.
+uint32_t tick_begin(struct App *app) {
     if (app->running == false || app->won || app->game_over) {
+        return 0;
+    }
+
+    uint32_t due = timer_wheel_advance(&app->timers);
+    if (due == 0) {
+        return 0;
+    }
+
+    // Respawn delay is over: the ghosts start moving again
+    if (due & (1u << TIMER_RESPAWN)) {
+        int i;
+        for (i = 0; i < NUM_GHOSTS; i++) {
+            if (i != app->player_ghost) {
+                timer_wheel_schedule(&app->timers, TIMER_GHOST + i, ghost_period(app, &app->ghosts[i]));
+            }
+        }
+    }
+
+    // Pac-man keeps going the way he faces
+    if (due & (1u << TIMER_PACMAN)) {
+        move_pacman(app, GHOST_DIR_ROW[app->pacman_dir], GHOST_DIR_COL[app->pacman_dir]);
+        timer_wheel_schedule(&app->timers, TIMER_PACMAN, ms_to_ticks(app->params->pacman_ms));
+        check_collision(app);
+        if (app->game_over) {
+            return 0;
+        }
+    }
+    return due;
+}
+
+// Last part of a tick, once the ghosts due have moved
+void tick_end(struct App *app, uint32_t due) {
+    if (due & GHOST_TIMERS) {
+        check_collision(app);
+    }
+    check_won(app);
+}
+
+// Update game state (called every APP_TICK_MS)
+void app_tick(struct App *app) {
+    uint32_t due = tick_begin(app);
+    if (due == 0) {
         return;
     }
+    if (due & GHOST_TIMERS) {
+        move_ghosts(app, due);
+    }
+    tick_end(app, due);
+}
+
+void app_tick_many(struct App **apps, int count) {
+    struct GhostPlan plan;
+    uint32_t due[APP_TICK_GROUP];
+    int first, i;
+
+    plan.batch.count = 0;
+    for (first = 0; first < count; first = first + APP_TICK_GROUP) {
+        int group = count - first < APP_TICK_GROUP ? count - first : APP_TICK_GROUP;
+        for (i = 0; i < group; i++) {
+            due[i] = tick_begin(apps[first + i]);
+            if (due[i] & GHOST_TIMERS) {
+                app_plan_ghosts(&plan, apps[first + i], due[i]);
+            }
+        }
+        app_move_planned_ghosts(&plan);
+        for (i = 0; i < group; i++) {
+            if (due[i] != 0) {
+                tick_end(apps[first + i], due[i]);
+            }
+        }
+    }
+}
+
+void app_move_ghost(struct App *app, int cmd) {
+    if (app->player_ghost < 0 || app->game_over || app->won) {
+        return;
+    }
+
+    int dir = -1;
+    if (cmd == 'w' || cmd == 'W') dir = GHOST_DIR_UP;
+    else if (cmd == 's' || cmd == 'S') dir = GHOST_DIR_DOWN;
+    else if (cmd == 'a' || cmd == 'A') dir = GHOST_DIR_LEFT;
+    else if (cmd == 'd' || cmd == 'D') dir = GHOST_DIR_RIGHT;
+    if (dir < 0) {
+        return;
+    }
+
+    struct Ghost *ghost = &app->ghosts[app->player_ghost];
+    int nr = ghost->pos.row + GHOST_DIR_ROW[dir];
+    int nc = ghost->pos.col + GHOST_DIR_COL[dir];
+    if (is_walkable(app, nr, nc) == false) {
+        return;
+    }
+    ghost->pos.row = nr;
+    ghost->pos.col = nc;
+    ghost->last_dir = dir;
+    app->needs_redraw = true;
+    telemetry_record(TELEMETRY_GHOST_MOVE, app->id, app->timers.now, nr, nc, ghost->type, dir);
 
-    move_ghosts(app);
     check_collision(app);
+}
 
-    if (app->dots_remaining == 0 && app->won == false) {
-        app->won = true;
-        app->needs_redraw = true;
-        platform_play_sound(SOUND_WIN);
-        platform_save_highscore(app->high_score);
+// FNV-1a
+uint32_t checksum_add(uint32_t hash, const void *data, size_t len) {
+    const unsigned char *bytes = data;
+    size_t i;
+    for (i = 0; i < len; i++) {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+    return hash;
+}
+
+uint32_t app_checksum(const struct App *app) {
+    uint32_t hash = 2166136261u;
+    int i;
+
+    // Field by field: the pointers and the high score differ between
+    // processes without the games being any different
+    hash = checksum_add(hash, &app->score, sizeof(app->score));
+    hash = checksum_add(hash, &app->lives, sizeof(app->lives));
+    hash = checksum_add(hash, &app->dots_remaining, sizeof(app->dots_remaining));
+    hash = checksum_add(hash, &app->won, sizeof(app->won));
+    hash = checksum_add(hash, &app->game_over, sizeof(app->game_over));
+    hash = checksum_add(hash, &app->pacman, sizeof(app->pacman));
+    hash = checksum_add(hash, &app->pacman_dir, sizeof(app->pacman_dir));
+    for (i = 0; i < NUM_GHOSTS; i++) {
+        hash = checksum_add(hash, &app->ghosts[i].pos, sizeof(app->ghosts[i].pos));
+        hash = checksum_add(hash, &app->ghosts[i].last_dir, sizeof(app->ghosts[i].last_dir));
+    }
+    hash = checksum_add(hash, &app->rng, sizeof(app->rng));
+    hash = checksum_add(hash, &app->timers, sizeof(app->timers));
+
+    // Dots a word at a time, since big mazes have a lot of them
+    const uint64_t *dots = app_dots_const(app);
+    uint64_t mix = hash;
+    for (i = 0; i < app->level->words; i++) {
+        mix = (mix ^ dots[i]) * 0x100000001b3ull;
+        mix = mix ^ (mix >> 29);
     }
+    return (uint32_t)(mix ^ (mix >> 32));
 }
@@ -1,16 +1,17 @@
+#pragma once
+
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 
-// Position on the map
-struct Position {
-    int row;
-    int col;
-};
+#include "ghost_kernel.h"
+#include "level.h"
+#include "screen.h"
+#include "timer_wheel.h"
 
 // Game settings
-#define MAP_HEIGHT 15
-#define MAP_WIDTH 40
-#define FRAME_BUFFER_SIZE 16384
-#define NUM_GHOSTS 4
+#define FRAME_BUFFER_SIZE SCREEN_MAX_BYTES
+#define CACHE_LINE_SIZE 64
 
 // Different ghost types
 #define GHOST_CHASER 0    // Red ghost - chases Pac-Man directly
@@ -18,38 +19,193 @@ struct Position {
 #define GHOST_FLANKER 2   // Cyan ghost - tries to flank
 #define GHOST_RANDOM 3    // Orange ghost - moves randomly
 
+// Session flags
+#define APP_HEADLESS 1    // No sound and no high score file (bots, benchmarks)
+
+// How often ghosts move by default (in milliseconds)
+#define GAME_TICK_MS 400
+
+// Length of one simulation tick (app_tick). Every speed and delay is
+// rounded to whole ticks.
+#define APP_TICK_MS 20
+
+// Timers in each session's timer wheel
+#define TIMER_PACMAN 0                          // Pac-man keeps moving on its own
+#define TIMER_GHOST 1                           // Ghost i uses TIMER_GHOST + i
+#define TIMER_RESPAWN (TIMER_GHOST + NUM_GHOSTS) // Ghosts wait after pac-man dies
+
+// How one ghost type picks its target. Every ghost aims at pac-man,
+// moved `lookahead` tiles the way pac-man is facing and `flank` tiles
+// sideways towards the ghost. A ghost with chase_percent below 100 only
+// chases that often and wanders otherwise.
+struct GhostBehaviour {
+    int lookahead;
+    int flank;
+    int chase_percent;
+    int move_ms;        // Time between moves (0 = the shared tick_ms)
+};
+
+// Ghost AI level of detail. Ghosts within near_rows/near_cols of
+// pac-man (about what the screen shows around him) always decide
+// properly. Ghosts further away may make a cheap decision instead: keep
+// going the way they were, or head straight for pac-man's tile.
+#define AI_DETAIL_FULL 0    // Every decision is a proper one
+#define AI_DETAIL_FIXED 1   // Up to detail_budget far ghosts a tick decide properly.
+                            // Deterministic, so replays and two-player games agree.
+#define AI_DETAIL_TIMED 2   // Far ghosts decide properly until the tick's ghost AI has
+                            // used detail_budget microseconds. Not deterministic.
+
+// Ghost tuning, shared by every session that uses it
+struct GhostParams {
+    struct GhostBehaviour behaviours[4];  // Indexed by ghost type
+    int tick_ms;                          // Time between ghost moves
+    int pacman_ms;                        // Pac-man keeps going this often (0 = only on key presses)
+    int respawn_ms;                       // Ghosts wait this long after pac-man dies
+    int detail;                           // AI_DETAIL_*
+    int detail_budget;                    // Far ghosts a tick (fixed) or microseconds (timed)
+    int near_rows;                        // How close counts as near pac-man
+    int near_cols;
+};
+
+extern const struct GhostParams GHOST_PARAMS_DEFAULT;
+
+// Set the level of detail from "full", "fixed:FAR_GHOSTS" or
+// "timed:MICROSECONDS". Returns false if `text` is none of those.
+bool ghost_params_parse_detail(struct GhostParams *params, const char *text);
+
 // Ghost structure
 struct Ghost {
     struct Position pos;
-    struct Position start;
     int type;
     int last_dir;  // Last direction moved (0-3)
 };
 
-// Main game structure
+// Main game structure.
+//
+// This only holds what the simulation touches every tick, so lots of
+// sessions can sit in memory side by side. The maze itself lives in the
+// shared Level and the screen buffer lives in a Renderer. A session's
+// dots (a bit set, level->words long) sit right after the App in memory.
 struct App {
-    unsigned int score;
+    _Alignas(CACHE_LINE_SIZE) unsigned int score;
     unsigned int high_score;
     unsigned int lives;
     unsigned int max_lives;
     unsigned int dots_remaining;
+    int flags;
     bool running;
     bool won;
     bool game_over;
     bool needs_redraw;
     struct Position pacman;
-    struct Position pacman_start;
     int pacman_dir;
     struct Ghost ghosts[NUM_GHOSTS];
-    char map[MAP_HEIGHT][MAP_WIDTH + 1];
+    uint32_t rng;    // Random number state, so seeded games replay exactly
+    int player_ghost;  // Ghost moved by a second player instead of the AI, or -1
+    const struct Level *level;
+    const struct GhostParams *params;
+    struct TimerWheel timers;   // When pac-man, each ghost and events next act
+    uint32_t id;                // Session number, for telemetry
+    uint32_t ai_full;           // Ghost decisions made properly...
+    uint32_t ai_cheap;          // ...and cheaply (see AI_DETAIL_*)
+    uint32_t dots_first;        // Bit set words eaten from since the level was copied
+    uint32_t dots_last;         // (first > last: none)
+};
+
+// Dots still on the map
+static inline uint64_t *app_dots(struct App *app) {
+    return (uint64_t *)(app + 1);
+}
+
+static inline const uint64_t *app_dots_const(const struct App *app) {
+    return (const uint64_t *)(app + 1);
+}
+
+// Largest part of the maze drawn at once. Bigger mazes scroll to follow
+// pac-man. With the text around it, it fills the whole screen grid
+// (SCREEN_MAX_ROWS x SCREEN_MAX_COLS).
+#define RENDER_MAX_VIEW_ROWS (SCREEN_MAX_ROWS - 8)
+#define RENDER_MAX_VIEW_COLS (SCREEN_MAX_COLS - 4)
+
+// Screen output state. One per thread that draws, shared by every
+// session drawn on that thread.
+struct Renderer {
     char frame_buffer[FRAME_BUFFER_SIZE];
     int term_rows;
     int term_cols;
+
+    // Layout for the current terminal size (NULL level = work it out again)
+    const struct Level *layout_level;
+    int view_rows;      // Part of the maze that fits on screen
+    int view_cols;
+    int pad_top;
+    int pad_left;
+
+    struct Screen screen;   // What the terminal shows, for sending only changes
 };
 
+// Bytes needed for one session of a level (App plus its dots).
+// Sessions must always be allocated with at least this much room.
+size_t app_session_size(const struct Level *level);
+
 // Function declarations
-struct App app_create();
+struct App *app_create(const struct Level *level);
+void app_load_high_score(struct App *app);
+void app_init(struct App *app, const struct Level *level, int flags);
+void app_seed(struct App *app, uint32_t seed);
+void app_restart(struct App *app);
+
+// Use different ghost tuning. Restarts every timer, so call it before play.
+void app_set_params(struct App *app, const struct GhostParams *params);
 void app_destroy(struct App *app);
-void app_render(struct App *app);
+
+// Draw the game into the renderer's frame buffer. Returns the number of
+// bytes to send to the screen: only what changed since the last frame,
+// which must have been sent (0 if nothing did).
+int app_render(const struct App *app, struct Renderer *renderer);
+
+// Set up a renderer for a terminal that can do `caps`
+void renderer_init(struct Renderer *renderer, const struct ScreenCaps *caps);
+
+// Tell the renderer the terminal size changed. The next frame is drawn
+// whole.
+void renderer_resize(struct Renderer *renderer, int rows, int cols);
+
+// The terminal may not show the last frame (say it was dropped): draw the
+// next one whole
+void renderer_invalidate(struct Renderer *renderer);
 void app_handle_input(struct App *app, int cmd);
-void app_update(struct App *app);
+
+// Move the game on by one tick (APP_TICK_MS): whoever is due moves
+void app_tick(struct App *app);
+
+// Sessions whose ghosts fill a GhostBatch
+#define APP_TICK_GROUP (GHOST_BATCH_MAX / NUM_GHOSTS)
+
+// app_tick for many sessions at once. Each session ends up as if it had
+// been ticked on its own, but the ghosts of APP_TICK_GROUP sessions at a
+// time are scored together, so the SIMD kernel gets full batches. For
+// tools that run lots of headless games side by side.
+void app_tick_many(struct App **apps, int count);
+
+// Ghost moves planned from one or more sessions, to be scored together
+struct GhostPlan {
+    struct GhostBatch batch;
+    struct App *app[GHOST_BATCH_MAX];  // Session and ghost each slot is for
+    int ghost[GHOST_BATCH_MAX];
+    bool cheap[GHOST_BATCH_MAX];       // Decided the cheap way (see AI_DETAIL_*)
+};
+
+// Plan the moves of the session's ghosts whose timers are in `due` (bit
+// TIMER_GHOST + i). The plan must have room for NUM_GHOSTS more.
+void app_plan_ghosts(struct GhostPlan *plan, struct App *app, uint32_t due);
+
+// Score the plan in one go, move every ghost in it and empty it
+void app_move_planned_ghosts(struct GhostPlan *plan);
+
+// Move the player-controlled ghost one tile with a WASD key
+void app_move_ghost(struct App *app, int cmd);
+
+// Hash of everything the simulation depends on. Two sessions that went
+// through the same inputs from the same seed have the same checksum.
+uint32_t app_checksum(const struct App *app);
@@ -0,0 +1,113 @@
+/*
+ * Small set of atomic operations that work on every compiler we build with.
+ *
+ * GCC and Clang get the __atomic builtins, MSVC gets the Interlocked
+ * intrinsics. Loads are acquire, stores are release and read-modify-write
+ * operations are full barriers, which is all the lock-free code here needs.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#if defined(_MSC_VER)
+
+#include <intrin.h>
+
+static inline int atom_load(volatile int *p) {
+    return (int)_InterlockedOr((volatile long *)p, 0);
+}
+
+static inline void atom_store(volatile int *p, int value) {
+    _InterlockedExchange((volatile long *)p, (long)value);
+}
+
+static inline int atom_exchange(volatile int *p, int value) {
+    return (int)_InterlockedExchange((volatile long *)p, (long)value);
+}
+
+static inline int atom_add(volatile int *p, int value) {
+    return (int)_InterlockedExchangeAdd((volatile long *)p, (long)value);
+}
+
+static inline uint64_t atom_load64(volatile uint64_t *p) {
+    return (uint64_t)_InterlockedOr64((volatile __int64 *)p, 0);
+}
+
+// For memory this process may only read, such as a read-only shared
+// mapping: atom_load64 is an interlocked OR here, which writes
+static inline uint64_t atom_load64_readonly(const volatile uint64_t *p) {
+    uint64_t value = (uint64_t)__iso_volatile_load64((const volatile __int64 *)p);
+#if defined(_M_ARM64)
+    __dmb(_ARM64_BARRIER_ISH);
+#elif defined(_M_ARM)
+    __dmb(_ARM_BARRIER_ISH);
+#else
+    _ReadWriteBarrier();
+#endif
+    return value;
+}
+
+static inline void atom_store64(volatile uint64_t *p, uint64_t value) {
+    _InterlockedExchange64((volatile __int64 *)p, (__int64)value);
+}
+
+static inline uint64_t atom_add64(volatile uint64_t *p, uint64_t value) {
+    return (uint64_t)_InterlockedExchangeAdd64((volatile __int64 *)p, (__int64)value);
+}
+
+// Returns true if *p was `expected` and is now `desired`
+static inline int atom_cas64(volatile uint64_t *p, uint64_t expected, uint64_t desired) {
+    return (uint64_t)_InterlockedCompareExchange64((volatile __int64 *)p, (__int64)desired,
+                                                   (__int64)expected) == expected;
+}
+
+static inline void atom_fence() {
+    volatile long barrier = 0;
+    _InterlockedOr(&barrier, 0);
+}
+
+#else
+
+static inline int atom_load(volatile int *p) {
+    return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+}
+
+static inline void atom_store(volatile int *p, int value) {
+    __atomic_store_n(p, value, __ATOMIC_RELEASE);
+}
+
+static inline int atom_exchange(volatile int *p, int value) {
+    return __atomic_exchange_n(p, value, __ATOMIC_ACQ_REL);
+}
+
+static inline int atom_add(volatile int *p, int value) {
+    return __atomic_fetch_add(p, value, __ATOMIC_ACQ_REL);
+}
+
+static inline uint64_t atom_load64(volatile uint64_t *p) {
+    return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+}
+
+static inline uint64_t atom_load64_readonly(const volatile uint64_t *p) {
+    return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+}
+
+static inline void atom_store64(volatile uint64_t *p, uint64_t value) {
+    __atomic_store_n(p, value, __ATOMIC_RELEASE);
+}
+
+static inline uint64_t atom_add64(volatile uint64_t *p, uint64_t value) {
+    return __atomic_fetch_add(p, value, __ATOMIC_ACQ_REL);
+}
+
+// Returns true if *p was `expected` and is now `desired`
+static inline int atom_cas64(volatile uint64_t *p, uint64_t expected, uint64_t desired) {
+    return __atomic_compare_exchange_n(p, &expected, desired, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+}
+
+static inline void atom_fence() {
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+#endif
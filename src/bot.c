@@ -0,0 +1,244 @@
+#include "bot.h"
+#include "ghost_kernel.h"
+
+#include <stdlib.h>
+
+const char BOT_KEYS[4] = {'w', 's', 'a', 'd'};  // Same order as the ghost directions
+
+// First random state for a seed
+uint32_t bot_seed(uint32_t seed) {
+    uint32_t rng = seed * 2654435761u + 0x9e3779b9u;
+    return rng != 0 ? rng : 1;
+}
+
+bool bot_init(struct Bot *bot, int kind, const struct Level *level, uint32_t seed) {
+    bot->kind = kind;
+    bot->rng = bot_seed(seed);
+    bot->cells = level->rows * level->cols;
+    bot->queue = malloc((size_t)bot->cells * sizeof(int));
+    bot->first_dir = malloc((size_t)bot->cells * sizeof(int));
+    if (bot->queue == NULL || bot->first_dir == NULL) {
+        bot_free(bot);
+        return false;
+    }
+    return true;
+}
+
+void bot_free(struct Bot *bot) {
+    free(bot->queue);
+    free(bot->first_dir);
+    bot->queue = NULL;
+    bot->first_dir = NULL;
+}
+
+uint32_t bot_random(struct Bot *bot) {
+    uint32_t x = bot->rng;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    bot->rng = x;
+    return x;
+}
+
+bool bot_walkable(const struct Level *level, int row, int col) {
+    if (row < 0 || row >= level->rows || col < 0 || col >= level->cols) {
+        return false;
+    }
+    return level_is_wall(level, row, col) == false;
+}
+
+// A cell a ghost is on or right next to
+bool bot_dangerous(const struct App *app, int row, int col) {
+    int g;
+    for (g = 0; g < NUM_GHOSTS; g++) {
+        int dr = app->ghosts[g].pos.row - row;
+        int dc = app->ghosts[g].pos.col - col;
+        if (dr < 0) dr = -dr;
+        if (dc < 0) dc = -dc;
+        if (dr + dc <= 1) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Random step, avoiding walls
+int bot_random_key(struct Bot *bot, const struct App *app) {
+    int dirs[4];
+    int count = 0;
+    int d;
+    for (d = 0; d < 4; d++) {
+        if (bot_walkable(app->level, app->pacman.row + GHOST_DIR_ROW[d], app->pacman.col + GHOST_DIR_COL[d])) {
+            dirs[count] = d;
+            count = count + 1;
+        }
+    }
+    if (count == 0) {
+        return BOT_KEYS[0];
+    }
+    return BOT_KEYS[dirs[bot_random(bot) % (uint32_t)count]];
+}
+
+// Breadth-first search from pac-man through safe cells to the nearest dot
+int bot_greedy_key(struct Bot *bot, const struct App *app) {
+    const struct Level *level = app->level;
+    const uint64_t *dots = app_dots_const(app);
+    int head = 0;
+    int tail = 0;
+    int i, d;
+
+    for (i = 0; i < bot->cells; i++) {
+        bot->first_dir[i] = -1;
+    }
+
+    int start = level_cell(level, app->pacman.row, app->pacman.col);
+    bot->first_dir[start] = 4;  // Visited, no first step
+    bot->queue[tail] = start;
+    tail = tail + 1;
+
+    while (head < tail) {
+        int cell = bot->queue[head];
+        head = head + 1;
+        int row = cell / level->cols;
+        int col = cell % level->cols;
+
+        if (cell != start && level_bit(dots, cell)) {
+            return BOT_KEYS[bot->first_dir[cell]];
+        }
+
+        for (d = 0; d < 4; d++) {
+            int nr = row + GHOST_DIR_ROW[d];
+            int nc = col + GHOST_DIR_COL[d];
+            if (bot_walkable(level, nr, nc) == false || bot_dangerous(app, nr, nc)) {
+                continue;
+            }
+            int next = level_cell(level, nr, nc);
+            if (bot->first_dir[next] != -1) {
+                continue;
+            }
+            bot->first_dir[next] = cell == start ? d : bot->first_dir[cell];
+            bot->queue[tail] = next;
+            tail = tail + 1;
+        }
+    }
+
+    // No safe way to a dot: step away from the closest ghost if we can
+    int best_key = -1;
+    int best_dist = -1;
+    for (d = 0; d < 4; d++) {
+        int nr = app->pacman.row + GHOST_DIR_ROW[d];
+        int nc = app->pacman.col + GHOST_DIR_COL[d];
+        if (bot_walkable(level, nr, nc) == false) {
+            continue;
+        }
+        int nearest = 1 << 30;
+        int g;
+        for (g = 0; g < NUM_GHOSTS; g++) {
+            int dr = app->ghosts[g].pos.row - nr;
+            int dc = app->ghosts[g].pos.col - nc;
+            int dist = (dr < 0 ? -dr : dr) + (dc < 0 ? -dc : dc);
+            if (dist < nearest) nearest = dist;
+        }
+        if (nearest > best_dist) {
+            best_dist = nearest;
+            best_key = BOT_KEYS[d];
+        }
+    }
+    if (best_key == -1) {
+        return bot_random_key(bot, app);
+    }
+    return best_key;
+}
+
+int bot_next_key(struct Bot *bot, const struct App *app) {
+    if (bot->kind == BOT_RANDOM) {
+        return bot_random_key(bot, app);
+    }
+    return bot_greedy_key(bot, app);
+}
+
+void bot_play_game(struct Bot *bot, struct App *app, int move_ms, long max_ms, struct BotResult *result) {
+    long next_move = move_ms;
+    long next_tick = APP_TICK_MS;
+    unsigned int start_dots = app->dots_remaining;
+    unsigned int start_lives = app->lives;
+
+    result->time_ms = 0;
+    while (app->game_over == false && app->won == false && result->time_ms < max_ms) {
+        // Whichever comes first in simulated time; the player wins ties
+        if (next_move <= next_tick) {
+            app_handle_input(app, bot_next_key(bot, app));
+            next_move = next_move + move_ms;
+        } else {
+            app_tick(app);
+            result->time_ms = next_tick;
+            next_tick = next_tick + APP_TICK_MS;
+        }
+    }
+
+    result->won = app->won;
+    result->dots_eaten = start_dots - app->dots_remaining;
+    result->lives_lost = start_lives - app->lives;
+}
+
+void bot_play_games(struct Bot *bot, struct App **apps, const uint32_t *seeds, int count,
+                    int move_ms, long max_ms, struct BotResult *results) {
+    struct App *playing[BOT_MAX_GAMES];
+    int game[BOT_MAX_GAMES];      // Which of `apps` each one playing is
+    uint32_t rng[BOT_MAX_GAMES];
+    unsigned int start_dots[BOT_MAX_GAMES];
+    unsigned int start_lives[BOT_MAX_GAMES];
+    long next_move = move_ms;
+    long next_tick = APP_TICK_MS;
+    long time_ms = 0;
+    int games = count;
+    int i;
+
+    for (i = 0; i < games; i++) {
+        playing[i] = apps[i];
+        game[i] = i;
+        rng[i] = bot_seed(seeds[i]);
+        start_dots[i] = apps[i]->dots_remaining;
+        start_lives[i] = apps[i]->lives;
+        results[i].time_ms = 0;
+    }
+
+    while (count > 0) {
+        // Drop the games that are over, as bot_play_game would stop
+        int kept = 0;
+        for (i = 0; i < count; i++) {
+            struct App *app = playing[i];
+            if (app->game_over == false && app->won == false && time_ms < max_ms) {
+                playing[kept] = playing[i];
+                game[kept] = game[i];
+                rng[kept] = rng[i];
+                kept = kept + 1;
+            }
+        }
+        count = kept;
+
+        // Whichever comes first in simulated time; the player wins ties
+        if (next_move <= next_tick) {
+            for (i = 0; i < count; i++) {
+                bot->rng = rng[i];
+                app_handle_input(playing[i], bot_next_key(bot, playing[i]));
+                rng[i] = bot->rng;
+            }
+            next_move = next_move + move_ms;
+        } else {
+            app_tick_many(playing, count);
+            time_ms = next_tick;
+            for (i = 0; i < count; i++) {
+                results[game[i]].time_ms = time_ms;
+            }
+            next_tick = next_tick + APP_TICK_MS;
+        }
+    }
+
+    for (i = 0; i < games; i++) {
+        results[i].won = apps[i]->won;
+        results[i].dots_eaten = start_dots[i] - apps[i]->dots_remaining;
+        results[i].lives_lost = start_lives[i] - apps[i]->lives;
+    }
+}
+
@@ -0,0 +1,57 @@
+/*
+ * Computer players for headless games.
+ *
+ * Used by the tools that play thousands of games without a screen (AI
+ * tuning, benchmarks). Everything runs in simulated time and all the
+ * randomness comes from seeds, so the same seed plays the same game.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "app.h"
+
+#define BOT_GREEDY 0   // Walks to the nearest dot, steering clear of ghosts
+#define BOT_RANDOM 1   // Wanders around at random
+
+// How often a bot presses a key by default (like holding down a key)
+#define BOT_MOVE_MS 150
+
+// Most games bot_play_games plays at once
+#define BOT_MAX_GAMES 64
+
+struct Bot {
+    int kind;
+    uint32_t rng;
+    int cells;
+    int *queue;        // BFS scratch, one per cell
+    int *first_dir;    // BFS scratch: first step towards each cell, -1 = not reached
+};
+
+// How a headless game went
+struct BotResult {
+    bool won;
+    long time_ms;               // Simulated time played
+    unsigned int dots_eaten;
+    unsigned int lives_lost;
+};
+
+bool bot_init(struct Bot *bot, int kind, const struct Level *level, uint32_t seed);
+void bot_free(struct Bot *bot);
+
+// The key the bot presses next ('w', 'a', 's' or 'd')
+int bot_next_key(struct Bot *bot, const struct App *app);
+
+// Play one game from the session's current state until it is won, lost or
+// `max_ms` of simulated time has gone by. The bot presses a key every
+// `move_ms` and the game ticks every APP_TICK_MS.
+void bot_play_game(struct Bot *bot, struct App *app, int move_ms, long max_ms, struct BotResult *result);
+
+// Play `count` (up to BOT_MAX_GAMES) games side by side, each exactly as
+// bot_play_game would with a bot seeded from seeds[i], so their ghosts
+// can be scored together (app_tick_many). `bot` lends its scratch space.
+void bot_play_games(struct Bot *bot, struct App **apps, const uint32_t *seeds, int count,
+                    int move_ms, long max_ms, struct BotResult *results);
+
@@ -0,0 +1,193 @@
+#include "campaign.h"
+#include "atomics.h"
+
+#include <string.h>
+
+// Time between moves on level `number`, starting from `ms` on level 1
+int campaign_speed(int ms, int number) {
+    int i;
+    if (ms <= CAMPAIGN_MIN_TICK_MS) {
+        return ms;
+    }
+    for (i = 1; i < number && ms > CAMPAIGN_MIN_TICK_MS; i++) {
+        ms = ms * (100 - CAMPAIGN_SPEEDUP_PERCENT) / 100;
+    }
+    return ms < CAMPAIGN_MIN_TICK_MS ? CAMPAIGN_MIN_TICK_MS : ms;
+}
+
+// Worker: build level `number` and set the spare session up on it
+bool build_level(struct Campaign *campaign, int number) {
+    struct CampaignLevel *slot = &campaign->slots[campaign->built % 3];
+    long long start = platform_time_ns();
+    int i;
+
+    if (slot->generated) {
+        level_free(&slot->level);
+        slot->generated = false;
+    }
+    if (level_generate(&slot->level, campaign->rows, campaign->cols, campaign->seed + (uint32_t)number) == false) {
+        return false;
+    }
+    slot->generated = true;
+    slot->level.number = number;
+
+    slot->params = campaign->base;
+    slot->params.tick_ms = campaign_speed(campaign->base.tick_ms, number);
+    for (i = 0; i < 4; i++) {
+        slot->params.behaviours[i].move_ms = campaign_speed(campaign->base.behaviours[i].move_ms, number);
+    }
+
+    app_init(campaign->spare, &slot->level, 0);
+    app_set_params(campaign->spare, &slot->params);
+
+    long long elapsed = platform_time_ns() - start;
+    campaign->built = campaign->built + 1;
+    campaign->build_ns = campaign->build_ns + elapsed;
+    if (elapsed > campaign->build_max_ns) {
+        campaign->build_max_ns = elapsed;
+    }
+    return true;
+}
+
+// Builds each level as soon as the one before it starts. Checks for
+// work every few milliseconds; a level lasts far longer than that.
+void campaign_worker(void *arg) {
+    struct Campaign *campaign = arg;
+
+    while (atom_load(&campaign->stop) == 0) {
+        int wanted = atom_load(&campaign->wanted);
+        if (wanted == atom_load(&campaign->ready)) {
+            platform_sleep_ms(5);
+            continue;
+        }
+        if (build_level(campaign, wanted) == false) {
+            atom_store(&campaign->failed, 1);
+            break;
+        }
+        atom_store(&campaign->ready, wanted);
+    }
+}
+
+bool campaign_start(struct Campaign *campaign, const struct Level *first,
+                    const struct GhostParams *params, uint32_t seed, struct App *app) {
+    memset(campaign, 0, sizeof(*campaign));
+    campaign->base = *params;
+    campaign->rows = first->rows;
+    campaign->cols = first->cols;
+    campaign->seed = seed;
+
+    // Level 1 shares the caller's maze; the copy only adds its number
+    campaign->first.level = *first;
+    campaign->first.level.number = 1;
+    campaign->first.params = *params;
+
+    campaign->spare = platform_aligned_alloc(CACHE_LINE_SIZE, app_session_size(first));
+    if (campaign->spare == NULL) {
+        return false;
+    }
+    app->level = &campaign->first.level;
+    app_set_params(app, &campaign->first.params);
+    campaign->stats.level = 1;
+    campaign->stats.highest = 1;
+
+    campaign->wanted = 2;
+    campaign->worker = platform_thread_start(campaign_worker, campaign);
+    if (campaign->worker == NULL) {
+        platform_aligned_free(campaign->spare);
+        campaign->spare = NULL;
+        return false;
+    }
+    return true;
+}
+
+struct App *campaign_next(struct Campaign *campaign, struct App *app) {
+    int next = campaign->stats.level + 1;
+
+    if (atom_load(&campaign->ready) != next) {
+        if (campaign->waiting == false) {
+            campaign->waiting = true;
+            campaign->stats.late = campaign->stats.late + 1;
+        }
+        return NULL;
+    }
+
+    long long start = platform_time_ns();
+
+    // Everything that belongs to the player rather than the level
+    struct App *next_app = campaign->spare;
+    next_app->score = app->score;
+    next_app->high_score = app->high_score;
+    next_app->lives = app->lives;
+    next_app->max_lives = app->max_lives;
+    next_app->flags = app->flags;
+    next_app->rng = app->rng;
+    next_app->id = app->id;
+    next_app->ai_full = app->ai_full;
+    next_app->ai_cheap = app->ai_cheap;
+    next_app->running = app->running;
+
+    // The worker is idle until `wanted` changes, so `ready` is ours
+    campaign->spare = app;
+    campaign->waiting = false;
+    campaign->stats.level = next;
+    if (next > campaign->stats.highest) {
+        campaign->stats.highest = next;
+    }
+    atom_store(&campaign->ready, 0);
+    atom_store(&campaign->wanted, next + 1);
+
+    long long elapsed = platform_time_ns() - start;
+    if (elapsed > campaign->stats.swap_max_ns) {
+        campaign->stats.swap_max_ns = elapsed;
+    }
+    return next_app;
+}
+
+void campaign_restart(struct Campaign *campaign, struct App *app) {
+    if (campaign->stats.level == 1) {
+        return;
+    }
+
+    // The level's dots are all different, so the session starts afresh
+    // and only gets back what belongs to the player
+    struct App player = *app;
+    app_init(app, &campaign->first.level, player.flags);
+    app_set_params(app, &campaign->first.params);
+    app->high_score = player.high_score;
+    app->max_lives = player.max_lives;
+    app->lives = player.max_lives;
+    app->rng = player.rng;
+    app->id = player.id;
+    app->ai_full = player.ai_full;
+    app->ai_cheap = player.ai_cheap;
+
+    // Level 2 again. If the worker is building another level it finishes
+    // that first; `ready` won't say 2 until level 2 is in `spare`.
+    campaign->waiting = false;
+    campaign->stats.level = 1;
+    atom_store(&campaign->wanted, 2);
+}
+
+void campaign_stop(struct Campaign *campaign, struct CampaignStats *stats) {
+    int i;
+
+    atom_store(&campaign->stop, 1);
+    if (campaign->worker != NULL) {
+        platform_thread_join(campaign->worker);
+        campaign->worker = NULL;
+    }
+    for (i = 0; i < 3; i++) {
+        if (campaign->slots[i].generated) {
+            level_free(&campaign->slots[i].level);
+            campaign->slots[i].generated = false;
+        }
+    }
+    platform_aligned_free(campaign->spare);
+    campaign->spare = NULL;
+
+    // The worker is gone, so its counters can be read
+    *stats = campaign->stats;
+    stats->built = campaign->built;
+    stats->build_ns = campaign->build_ns;
+    stats->build_max_ns = campaign->build_max_ns;
+}
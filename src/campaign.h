@@ -0,0 +1,92 @@
+/*
+ * Campaign: one level after another, with the ghosts a little faster on
+ * each.
+ *
+ * Level 1 is the level the game started on, and starting again goes back
+ * to it. Every level after it is a generated maze of the same size, so a session's dots always fit the
+ * same memory. While a level is played, a worker thread builds the next
+ * one: the maze, its dots and wall shapes, and a whole session set up on
+ * it, ready to play. Moving on is then only a matter of carrying the
+ * score and lives over and swapping session pointers, so the game
+ * thread never waits on a maze being built.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "app.h"
+#include "level.h"
+#include "platform.h"
+
+// Ghosts move this much faster on every level...
+#define CAMPAIGN_SPEEDUP_PERCENT 10
+
+// ...down to this many milliseconds between moves
+#define CAMPAIGN_MIN_TICK_MS 120
+
+// How long a cleared level stays on screen before the next one
+#define CAMPAIGN_PAUSE_MS 2000
+
+struct CampaignLevel {
+    struct Level level;
+    struct GhostParams params;
+    bool generated;            // Built by the worker, so it has to be freed
+};
+
+struct CampaignStats {
+    int level;                 // Level being played
+    int highest;               // Furthest level reached, over restarts
+    int built;                 // Levels the worker built
+    long long build_ns;        // Time the worker spent building them...
+    long long build_max_ns;    // ...and the longest one
+    long long swap_max_ns;     // Longest level change on the game thread
+    int late;                  // Level changes that had to wait for the worker
+};
+
+struct Campaign {
+    struct CampaignLevel first;  // Level 1: the caller's maze, numbered
+
+    // Levels after the first take turns in these. A slot is reused three
+    // builds on, once no snapshot can still be showing the level that
+    // was in it.
+    struct CampaignLevel slots[3];
+    struct App *spare;         // Session for the next level (worker, then game thread)
+    struct GhostParams base;   // Ghost tuning for level 1
+    int rows, cols;            // Size of every level
+    uint32_t seed;
+    bool waiting;              // Game thread: the level is won but the next isn't ready
+    struct PlatformThread *worker;
+    volatile int wanted;       // Level the worker should build next (game thread)
+    volatile int ready;        // Level waiting in `spare` (worker), 0 once taken
+    volatile int stop;
+    volatile int failed;       // Out of memory: the campaign ends on the current level
+    struct CampaignStats stats;  // Game thread; campaign_stop adds the worker's part
+
+    // The worker's share of the stats. Only the worker touches these
+    // until campaign_stop has joined it.
+    int built;
+    long long build_ns;
+    long long build_max_ns;
+};
+
+// Start a campaign on `first`, with `params` for level 1. Later levels
+// are generated from `seed`. Sets up level 1 in `app` (which must have
+// been made for `first`) and starts building level 2.
+bool campaign_start(struct Campaign *campaign, const struct Level *first,
+                    const struct GhostParams *params, uint32_t seed, struct App *app);
+
+// Game thread: move on from a won level. Returns the session for the
+// next level with the score and lives carried over, or NULL if it isn't
+// built yet (try again later). The old session becomes the spare.
+struct App *campaign_next(struct Campaign *campaign, struct App *app);
+
+// Game thread: the player starts again. From a later level the run goes
+// back to level 1: `app` is set up on it afresh, keeping the high score
+// and settings, and the builder starts on level 2 again. On level 1
+// there is nothing to do (app_restart puts the level back).
+void campaign_restart(struct Campaign *campaign, struct App *app);
+
+// Stop the worker and free every level and the spare session
+void campaign_stop(struct Campaign *campaign, struct CampaignStats *stats);
@@ -0,0 +1,129 @@
+#include "ghost_kernel.h"
+
+#include <limits.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define GHOST_KERNEL_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define GHOST_KERNEL_SSE2
+#endif
+
+const int GHOST_DIR_ROW[4] = {-1, 1, 0, 0};
+const int GHOST_DIR_COL[4] = {0, 0, -1, 1};
+
+// A move is scored as distance * 4 + direction. The smallest score wins,
+// so ties automatically go to the lowest direction and the winning
+// direction is just the low two bits. Blocked moves score NO_MOVE.
+#define NO_MOVE INT_MAX
+
+void ghost_kernel_score_scalar(struct GhostBatch *batch, int start) {
+    int i, d;
+    for (i = start; i < batch->count; i++) {
+        int best = NO_MOVE;
+        for (d = 0; d < 4; d++) {
+            int dr = batch->row[i] + GHOST_DIR_ROW[d] - batch->target_row[i];
+            int dc = batch->col[i] + GHOST_DIR_COL[d] - batch->target_col[i];
+            int dist = (dr < 0 ? -dr : dr) + (dc < 0 ? -dc : dc);
+            int allowed = (batch->dir_mask[i] >> d) & 1;
+            int score = allowed ? dist * 4 + d : NO_MOVE;
+            best = score < best ? score : best;
+        }
+        batch->chosen[i] = best == NO_MOVE ? -1 : (best & 3);
+    }
+}
+
+#if defined(GHOST_KERNEL_AVX2)
+
+// 8 ghosts at a time
+void ghost_kernel_score(struct GhostBatch *batch) {
+    int i, d;
+    const __m256i no_move = _mm256_set1_epi32(NO_MOVE);
+    for (i = 0; i + 8 <= batch->count; i += 8) {
+        __m256i row = _mm256_loadu_si256((const __m256i *)&batch->row[i]);
+        __m256i col = _mm256_loadu_si256((const __m256i *)&batch->col[i]);
+        __m256i dr0 = _mm256_sub_epi32(row, _mm256_loadu_si256((const __m256i *)&batch->target_row[i]));
+        __m256i dc0 = _mm256_sub_epi32(col, _mm256_loadu_si256((const __m256i *)&batch->target_col[i]));
+        __m256i mask = _mm256_loadu_si256((const __m256i *)&batch->dir_mask[i]);
+        __m256i best = no_move;
+
+        for (d = 0; d < 4; d++) {
+            __m256i dr = _mm256_add_epi32(dr0, _mm256_set1_epi32(GHOST_DIR_ROW[d]));
+            __m256i dc = _mm256_add_epi32(dc0, _mm256_set1_epi32(GHOST_DIR_COL[d]));
+            __m256i dist = _mm256_add_epi32(_mm256_abs_epi32(dr), _mm256_abs_epi32(dc));
+            __m256i score = _mm256_add_epi32(_mm256_slli_epi32(dist, 2), _mm256_set1_epi32(d));
+            __m256i bit = _mm256_set1_epi32(1 << d);
+            __m256i allowed = _mm256_cmpeq_epi32(_mm256_and_si256(mask, bit), bit);
+            score = _mm256_blendv_epi8(no_move, score, allowed);
+            best = _mm256_min_epi32(best, score);
+        }
+
+        __m256i none = _mm256_cmpeq_epi32(best, no_move);
+        __m256i dir = _mm256_and_si256(best, _mm256_set1_epi32(3));
+        _mm256_storeu_si256((__m256i *)&batch->chosen[i], _mm256_or_si256(dir, none));
+    }
+    ghost_kernel_score_scalar(batch, i);
+}
+
+const char *ghost_kernel_name() {
+    return "avx2";
+}
+
+#elif defined(GHOST_KERNEL_SSE2)
+
+// SSE2 has no 32-bit abs or min, so build them from compares
+static __m128i abs_epi32(__m128i x) {
+    __m128i sign = _mm_srai_epi32(x, 31);
+    return _mm_sub_epi32(_mm_xor_si128(x, sign), sign);
+}
+
+static __m128i select_epi32(__m128i cond, __m128i a, __m128i b) {
+    return _mm_or_si128(_mm_and_si128(cond, a), _mm_andnot_si128(cond, b));
+}
+
+// 4 ghosts at a time
+void ghost_kernel_score(struct GhostBatch *batch) {
+    int i, d;
+    const __m128i no_move = _mm_set1_epi32(NO_MOVE);
+    for (i = 0; i + 4 <= batch->count; i += 4) {
+        __m128i row = _mm_loadu_si128((const __m128i *)&batch->row[i]);
+        __m128i col = _mm_loadu_si128((const __m128i *)&batch->col[i]);
+        __m128i dr0 = _mm_sub_epi32(row, _mm_loadu_si128((const __m128i *)&batch->target_row[i]));
+        __m128i dc0 = _mm_sub_epi32(col, _mm_loadu_si128((const __m128i *)&batch->target_col[i]));
+        __m128i mask = _mm_loadu_si128((const __m128i *)&batch->dir_mask[i]);
+        __m128i best = no_move;
+
+        for (d = 0; d < 4; d++) {
+            __m128i dr = _mm_add_epi32(dr0, _mm_set1_epi32(GHOST_DIR_ROW[d]));
+            __m128i dc = _mm_add_epi32(dc0, _mm_set1_epi32(GHOST_DIR_COL[d]));
+            __m128i dist = _mm_add_epi32(abs_epi32(dr), abs_epi32(dc));
+            __m128i score = _mm_add_epi32(_mm_slli_epi32(dist, 2), _mm_set1_epi32(d));
+            __m128i bit = _mm_set1_epi32(1 << d);
+            __m128i allowed = _mm_cmpeq_epi32(_mm_and_si128(mask, bit), bit);
+            score = select_epi32(allowed, score, no_move);
+            best = select_epi32(_mm_cmplt_epi32(score, best), score, best);
+        }
+
+        __m128i none = _mm_cmpeq_epi32(best, no_move);
+        __m128i dir = _mm_and_si128(best, _mm_set1_epi32(3));
+        _mm_storeu_si128((__m128i *)&batch->chosen[i], _mm_or_si128(dir, none));
+    }
+    ghost_kernel_score_scalar(batch, i);
+}
+
+const char *ghost_kernel_name() {
+    return "sse2";
+}
+
+#else
+
+void ghost_kernel_score(struct GhostBatch *batch) {
+    ghost_kernel_score_scalar(batch, 0);
+}
+
+const char *ghost_kernel_name() {
+    return "scalar";
+}
+
+#endif
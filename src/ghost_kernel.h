@@ -0,0 +1,46 @@
+/*
+ * Batched ghost move scoring.
+ *
+ * Every ghost decision ends the same way: look at the directions the ghost
+ * is allowed to take, step one cell in each, and keep the one that lands
+ * closest (Manhattan distance) to the ghost's target. This file does that
+ * last step for a whole batch of ghosts at once so it can use SIMD.
+ *
+ * Ties go to the lowest direction (up, down, left, right), which is what
+ * the old one-ghost-at-a-time loop did.
+ */
+
+#pragma once
+
+// How many ghosts fit in one batch (multiple of 8 for AVX2)
+#define GHOST_BATCH_MAX 64
+
+// Directions: up, down, left, right
+#define GHOST_DIR_UP    0
+#define GHOST_DIR_DOWN  1
+#define GHOST_DIR_LEFT  2
+#define GHOST_DIR_RIGHT 3
+
+// Batch of ghosts to score, stored as one array per field
+struct GhostBatch {
+    int count;
+    int row[GHOST_BATCH_MAX];
+    int col[GHOST_BATCH_MAX];
+    int target_row[GHOST_BATCH_MAX];
+    int target_col[GHOST_BATCH_MAX];
+    int dir_mask[GHOST_BATCH_MAX];  // Bit d set = direction d is allowed
+    int chosen[GHOST_BATCH_MAX];    // Output: best direction, or -1 if none
+};
+
+// Row/column offset of each direction
+extern const int GHOST_DIR_ROW[4];
+extern const int GHOST_DIR_COL[4];
+
+// Pick the best direction for every ghost in the batch
+void ghost_kernel_score(struct GhostBatch *batch);
+
+// Plain C version, used for leftovers and as the reference
+void ghost_kernel_score_scalar(struct GhostBatch *batch, int start);
+
+// Name of the kernel picked at build time ("avx2", "sse2" or "scalar")
+const char *ghost_kernel_name();
@@ -0,0 +1,170 @@
+#include "leaderboard.h"
+#include "atomics.h"
+#include "platform.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// How often the disk writer checks for new scores
+#define FLUSH_INTERVAL_MS 1000
+
+#define HEADER_VALUE (((uint64_t)LEADERBOARD_MAGIC << 32) | LEADERBOARD_VERSION)
+
+struct LeaderboardFile *g_board = NULL;
+struct LeaderboardFile g_board_local;   // Used if the file can't be mapped
+struct PlatformThread *g_flush_thread = NULL;
+volatile int g_flush_stop = 0;
+volatile int g_tag_counter = 0;
+uint32_t g_tag_base = 0;
+
+// Disk writer: flush the mapping whenever the change counter moved
+void flush_thread(void *arg) {
+    uint64_t flushed = atom_load64(&g_board->changes);
+    int waited = 0;
+    (void)arg;
+
+    while (atom_load(&g_flush_stop) == 0) {
+        platform_sleep_ms(50);
+        waited = waited + 50;
+        if (waited < FLUSH_INTERVAL_MS) {
+            continue;
+        }
+        waited = 0;
+
+        uint64_t changes = atom_load64(&g_board->changes);
+        if (changes != flushed) {
+            platform_flush_shared(g_board, sizeof(*g_board));
+            flushed = changes;
+        }
+    }
+
+    if (atom_load64(&g_board->changes) != flushed) {
+        platform_flush_shared(g_board, sizeof(*g_board));
+    }
+}
+
+bool leaderboard_open() {
+    if (g_board != NULL) {
+        return g_board != &g_board_local;
+    }
+
+    g_tag_base = (uint32_t)time(NULL) ^ ((uint32_t)(uintptr_t)&g_tag_counter << 8);
+
+    char path[512];
+    struct LeaderboardFile *board = NULL;
+    if (platform_get_highscore_path(path, sizeof(path))) {
+        board = platform_map_shared(path, sizeof(*board));
+    }
+    if (board == NULL) {
+        g_board = &g_board_local;
+        return false;
+    }
+
+    // A fresh file is all zeros; the first process to get here stamps it.
+    // Anything else in the header is a file we don't understand.
+    atom_cas64(&board->header, 0, HEADER_VALUE);
+    if (atom_load64(&board->header) != HEADER_VALUE) {
+        platform_unmap_shared(board, sizeof(*board));
+        g_board = &g_board_local;
+        return false;
+    }
+
+    g_board = board;
+    g_flush_stop = 0;
+    g_flush_thread = platform_thread_start(flush_thread, NULL);
+    return true;
+}
+
+void leaderboard_close() {
+    if (g_board == NULL || g_board == &g_board_local) {
+        return;
+    }
+    atom_store(&g_flush_stop, 1);
+    if (g_flush_thread != NULL) {
+        platform_thread_join(g_flush_thread);
+        g_flush_thread = NULL;
+    } else {
+        platform_flush_shared(g_board, sizeof(*g_board));
+    }
+    platform_unmap_shared(g_board, sizeof(*g_board));
+    g_board = NULL;
+}
+
+void leaderboard_submit(unsigned int score) {
+    if (score == 0) {
+        return;
+    }
+    if (g_board == NULL) {
+        leaderboard_open();
+    }
+
+    uint32_t tag = g_tag_base + (uint32_t)atom_add(&g_tag_counter, 1);
+    uint64_t entry = ((uint64_t)score << 32) | tag;
+
+    // Replace the lowest entry. Entries only ever go up, so if the CAS
+    // fails someone else raised that slot and we just look again.
+    while (true) {
+        int lowest = 0;
+        uint64_t lowest_value = atom_load64(&g_board->entries[0]);
+        int i;
+        for (i = 1; i < LEADERBOARD_SIZE; i++) {
+            uint64_t value = atom_load64(&g_board->entries[i]);
+            if (value < lowest_value) {
+                lowest = i;
+                lowest_value = value;
+            }
+        }
+
+        if ((lowest_value >> 32) >= score && lowest_value != 0) {
+            return;  // Didn't make the board
+        }
+        if (atom_cas64(&g_board->entries[lowest], lowest_value, entry)) {
+            atom_add64(&g_board->changes, 1);
+            return;
+        }
+    }
+}
+
+unsigned int leaderboard_best() {
+    unsigned int best = 0;
+    int i;
+    if (g_board == NULL) {
+        leaderboard_open();
+    }
+    for (i = 0; i < LEADERBOARD_SIZE; i++) {
+        unsigned int score = (unsigned int)(atom_load64(&g_board->entries[i]) >> 32);
+        if (score > best) {
+            best = score;
+        }
+    }
+    return best;
+}
+
+int compare_scores(const void *a, const void *b) {
+    unsigned int x = *(const unsigned int *)a;
+    unsigned int y = *(const unsigned int *)b;
+    return (x < y) - (x > y);
+}
+
+int leaderboard_read(unsigned int *scores, int max) {
+    unsigned int all[LEADERBOARD_SIZE];
+    int count = 0;
+    int i;
+    if (g_board == NULL) {
+        leaderboard_open();
+    }
+    for (i = 0; i < LEADERBOARD_SIZE; i++) {
+        uint64_t value = atom_load64(&g_board->entries[i]);
+        if (value != 0) {
+            all[count] = (unsigned int)(value >> 32);
+            count = count + 1;
+        }
+    }
+    qsort(all, (size_t)count, sizeof(all[0]), compare_scores);
+    if (count > max) {
+        count = max;
+    }
+    memcpy(scores, all, (size_t)count * sizeof(scores[0]));
+    return count;
+}
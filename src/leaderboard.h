@@ -0,0 +1,41 @@
+/*
+ * High score leaderboard.
+ *
+ * The best LEADERBOARD_SIZE scores live in a small memory-mapped file
+ * that every game process on the machine shares. Posting a score is a
+ * few compare-and-swaps on that memory, so it never blocks the game;
+ * a background thread writes the file back to disk now and then.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define LEADERBOARD_MAGIC   0x4c434150u  // "PACL"
+#define LEADERBOARD_VERSION 1
+#define LEADERBOARD_SIZE    64
+
+// Layout of the shared file. Each entry is (score << 32 | tag), 0 = empty.
+// The tag just keeps equal scores from different games apart.
+struct LeaderboardFile {
+    volatile uint64_t header;   // MAGIC << 32 | VERSION, set by whoever made the file
+    volatile uint64_t changes;  // Goes up by one for every score that made the board
+    volatile uint64_t entries[LEADERBOARD_SIZE];
+};
+
+// Map the shared file and start the disk writer. Safe to call more than
+// once. Returns false (and keeps scores in memory only) on failure.
+bool leaderboard_open();
+
+// Write any changes to disk and stop the disk writer
+void leaderboard_close();
+
+// Post a finished game's score
+void leaderboard_submit(unsigned int score);
+
+// Best score on the board (0 if empty)
+unsigned int leaderboard_best();
+
+// Copy out up to `max` scores, best first. Returns how many.
+int leaderboard_read(unsigned int *scores, int max);
@@ -0,0 +1,378 @@
+#include "level.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// The maze layout
+const char *LEVEL_TEMPLATE[MAP_HEIGHT] = {
+    "########################################",
+    "#.........#..........#..........#......#",
+    "#.###.###.#.###.####.#.####.###.#.###..#",
+    "#.....#.....#...#....#....#...#.....#..#",
+    "#####.#.#####.#.#.##.#.##.#.#.#####.#.##",
+    "#.....#.......#.#.##.#.##.#.#.......#..#",
+    "#.#########.###.#....#....#.###.#######.#",
+    "#.............#.#.##.#.##.#.#...........#",
+    "#.###.#######.#.#.##.#.##.#.#.#######.###",
+    "#...#.#.......#.#....#....#.#.......#...#",
+    "#.#.#.#.#######.######.######.#######.#.#",
+    "#.#.#.#.........#....#........#.......#.#",
+    "#.#.#.###########.##.#.########.#######.#",
+    "#.#.....................................#",
+    "########################################",
+};
+
+// 64 bits of a bit set starting at any bit. Bits before the start or
+// past the end of the set are 0.
+uint64_t bits_from(const uint64_t *bits, int words, long long start) {
+    if (start < 0) {
+        return start <= -64 ? 0 : bits_from(bits, words, 0) << -start;
+    }
+    long long word = start >> 6;
+    int shift = (int)(start & 63);
+    uint64_t value = word < words ? bits[word] >> shift : 0;
+    if (shift > 0 && word + 1 < words) {
+        value |= bits[word + 1] << (64 - shift);
+    }
+    return value;
+}
+
+// Note which neighbours of every wall are walls. Works on 64 cells at a
+// time and turns each bit of a neighbour mask into its place in the 4-bit
+// shapes with a table, so even the biggest maze only takes a moment.
+bool find_wall_shapes(struct Level *level) {
+    static uint32_t spread[256];   // Bit i of the index moved to bit 4i
+    long long cells = (long long)level->rows * level->cols;
+    int cols = level->cols;
+    int i, b;
+
+    level->wall_shapes = malloc((size_t)level->words * 32);
+    if (level->wall_shapes == NULL) {
+        return false;
+    }
+    if (spread[255] == 0) {
+        for (i = 0; i < 256; i++) {
+            uint32_t value = 0;
+            for (b = 0; b < 8; b++) {
+                value |= (uint32_t)((i >> b) & 1) << (4 * b);
+            }
+            spread[i] = value;
+        }
+    }
+
+    for (i = 0; i < level->words; i++) {
+        long long first = (long long)i * 64;
+        uint64_t valid = cells - first >= 64 ? ~(uint64_t)0 : ((uint64_t)1 << (cells - first)) - 1;
+        uint64_t wall = level->walls[i] & valid;
+        uint8_t *out = &level->wall_shapes[(size_t)i * 32];
+        if (wall == 0) {
+            memset(out, 0, 32);
+            continue;
+        }
+
+        // Cells in the first and last column have no neighbour on one side
+        uint64_t first_col = 0;
+        long long col = (cols - first % cols) % cols;
+        while (col < 65) {
+            if (col < 64) first_col |= (uint64_t)1 << col;
+            col = col + cols;
+        }
+        uint64_t last_col = first_col >> 1;
+        if ((first + 64) % cols == 0) last_col |= (uint64_t)1 << 63;
+
+        uint64_t below_valid = cells - cols - first >= 64 ? ~(uint64_t)0 :
+                               cells - cols - first <= 0 ? 0 : ((uint64_t)1 << (cells - cols - first)) - 1;
+        uint64_t up = wall & bits_from(level->walls, level->words, first - cols);
+        uint64_t down = wall & bits_from(level->walls, level->words, first + cols) & below_valid;
+        uint64_t left = wall & bits_from(level->walls, level->words, first - 1) & ~first_col;
+        uint64_t right = wall & bits_from(level->walls, level->words, first + 1) & ~last_col;
+
+        for (b = 0; b < 8; b++) {
+            int shift = b * 8;
+            uint32_t nibbles = spread[(up >> shift) & 0xff] * WALL_UP |
+                               spread[(down >> shift) & 0xff] * WALL_DOWN |
+                               spread[(left >> shift) & 0xff] * WALL_LEFT |
+                               spread[(right >> shift) & 0xff] * WALL_RIGHT;
+            out[b * 4] = (uint8_t)nibbles;
+            out[b * 4 + 1] = (uint8_t)(nibbles >> 8);
+            out[b * 4 + 2] = (uint8_t)(nibbles >> 16);
+            out[b * 4 + 3] = (uint8_t)(nibbles >> 24);
+        }
+    }
+    return true;
+}
+
+bool level_load(struct Level *level, const char *const *rows, int height, int width) {
+    int r, c;
+
+    memset(level, 0, sizeof(*level));
+    level->rows = height;
+    level->cols = width;
+    level->words = (height * width + 63) / 64;
+    level->walls = calloc((size_t)level->words, sizeof(uint64_t));
+    level->dots = calloc((size_t)level->words, sizeof(uint64_t));
+    if (level->walls == NULL || level->dots == NULL) {
+        level_free(level);
+        return false;
+    }
+
+    for (r = 0; r < height; r++) {
+        // Rows shorter than the map are padded with floor
+        size_t len = strlen(rows[r]);
+        for (c = 0; c < width && (size_t)c < len; c++) {
+            int cell = level_cell(level, r, c);
+            if (rows[r][c] == '#') {
+                level->walls[cell >> 6] |= (uint64_t)1 << (cell & 63);
+            } else if (rows[r][c] == '.') {
+                level->dots[cell >> 6] |= (uint64_t)1 << (cell & 63);
+                level->dot_count = level->dot_count + 1;
+            }
+        }
+    }
+    if (find_wall_shapes(level) == false) {
+        level_free(level);
+        return false;
+    }
+    return true;
+}
+
+// Random numbers for the maze generator (xorshift32). Coin flips are
+// taken one bit at a time so most of them don't need a new number.
+struct MazeRandom {
+    uint32_t state;
+    uint32_t bits;
+    int bits_left;
+};
+
+uint32_t maze_random(struct MazeRandom *rng) {
+    uint32_t x = rng->state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    rng->state = x;
+    return x;
+}
+
+bool maze_coin(struct MazeRandom *rng) {
+    if (rng->bits_left == 0) {
+        rng->bits = maze_random(rng);
+        rng->bits_left = 32;
+    }
+    bool heads = rng->bits & 1;
+    rng->bits >>= 1;
+    rng->bits_left = rng->bits_left - 1;
+    return heads;
+}
+
+// Random number from 0 to n-1
+int maze_below(struct MazeRandom *rng, int n) {
+    return (int)(((uint64_t)maze_random(rng) * (uint32_t)n) >> 32);
+}
+
+// Knock out a wall cell and its mirror image across the middle
+void maze_open(uint64_t *walls, int cell, int twin) {
+    walls[cell >> 6] &= ~((uint64_t)1 << (cell & 63));
+    walls[twin >> 6] &= ~((uint64_t)1 << (twin & 63));
+}
+
+// Count the set bits in a word
+int count_bits(uint64_t x) {
+    x = x - ((x >> 1) & 0x5555555555555555ull);
+    x = (x & 0x3333333333333333ull) + ((x >> 2) & 0x3333333333333333ull);
+    x = (x + (x >> 4)) & 0x0f0f0f0f0f0f0f0full;
+    return (int)((x * 0x0101010101010101ull) >> 56);
+}
+
+// Layout of a maze being generated. Rooms sit on odd rows and columns
+// with a wall cell between each pair, so the maze is h x w rooms.
+struct MazeShape {
+    int cols;
+    int h;
+    int half;       // Room columns we generate, the rest are mirrored
+    int mirror;     // Column c mirrors to mirror - c
+};
+
+// Sidewinder, one room row at a time. The top row is a single corridor.
+// Every other row is cut into runs, and each run gets one opening to the
+// row above, which makes a spanning tree: every room is reachable.
+void maze_carve_row(uint64_t *walls, const struct MazeShape *shape, int y, struct MazeRandom *rng) {
+    int base = (2 * y + 1) * shape->cols;
+    int above = base - shape->cols;
+    int run_start = 0;
+    int x;
+
+    for (x = 0; x < shape->half; x++) {
+        int col = 2 * x + 1;
+        maze_open(walls, base + col, base + shape->mirror - col);
+        if (y == 0) {
+            if (x + 1 < shape->half) {
+                maze_open(walls, base + col + 1, base + shape->mirror - col - 1);
+            }
+        } else if (x + 1 < shape->half && maze_coin(rng)) {
+            maze_open(walls, base + col + 1, base + shape->mirror - col - 1);
+        } else {
+            int pick = 2 * (run_start + maze_below(rng, x - run_start + 1)) + 1;
+            maze_open(walls, above + pick, above + shape->mirror - pick);
+            run_start = x + 1;
+        }
+    }
+}
+
+// Braid: give every dead end in a room row a second way out. That adds the
+// loops ghosts and pac-man need to get around each other. Opening a wall
+// never makes a new dead end, so one pass is enough.
+void maze_braid_row(uint64_t *walls, const struct MazeShape *shape, int y, struct MazeRandom *rng) {
+    int base = (2 * y + 1) * shape->cols;
+    int x, i;
+
+    for (x = 0; x < shape->half; x++) {
+        int col = 2 * x + 1;
+        int sides[4];
+        sides[0] = base - shape->cols + col;   // Up
+        sides[1] = base + shape->cols + col;   // Down
+        sides[2] = base + col - 1;             // Left
+        sides[3] = base + col + 1;             // Right
+
+        int open_count = 0;
+        for (i = 0; i < 4; i++) {
+            open_count = open_count + (level_bit(walls, sides[i]) == false);
+        }
+        if (open_count != 1) {
+            continue;
+        }
+
+        // Any closed side that isn't the outer wall will do
+        int closed[4];
+        int closed_count = 0;
+        if (y > 0 && level_bit(walls, sides[0])) closed[closed_count++] = 0;
+        if (y + 1 < shape->h && level_bit(walls, sides[1])) closed[closed_count++] = 1;
+        if (x > 0 && level_bit(walls, sides[2])) closed[closed_count++] = 2;
+        if (col + 1 < shape->mirror && level_bit(walls, sides[3])) closed[closed_count++] = 3;
+        if (closed_count > 0) {
+            i = closed[maze_below(rng, closed_count)];
+            int row_base = sides[i] - sides[i] % shape->cols;
+            maze_open(walls, sides[i], row_base + shape->mirror - (sides[i] - row_base));
+        }
+    }
+}
+
+bool level_generate(struct Level *level, int rows, int cols, uint32_t seed) {
+    struct MazeShape shape;
+    struct MazeRandom rng;
+    int y, i;
+
+    if (rows < LEVEL_MIN_SIZE || cols < LEVEL_MIN_SIZE || rows > LEVEL_MAX_SIZE || cols > LEVEL_MAX_SIZE) {
+        return false;
+    }
+
+    memset(level, 0, sizeof(*level));
+    level->rows = rows;
+    level->cols = cols;
+    level->words = (rows * cols + 63) / 64;
+    level->walls = malloc((size_t)level->words * sizeof(uint64_t));
+    level->dots = malloc((size_t)level->words * sizeof(uint64_t));
+    if (level->walls == NULL || level->dots == NULL) {
+        level_free(level);
+        return false;
+    }
+
+    // An even size leaves one spare wall row or column along the bottom
+    // or right
+    int w = (cols - 1) / 2;
+    shape.cols = cols;
+    shape.h = (rows - 1) / 2;
+    shape.half = (w + 1) / 2;
+    shape.mirror = 2 * w;
+    rng.state = seed * 2654435761u + 0x9e3779b9u;
+    rng.bits_left = 0;
+    if (rng.state == 0) rng.state = 1;
+
+    // Start solid and carve straight into the wall bits
+    memset(level->walls, 0xff, (size_t)level->words * sizeof(uint64_t));
+
+    // With an even number of room columns the two halves don't share a
+    // column, so join them along the top
+    if (w % 2 == 0) {
+        maze_open(level->walls, cols + w, cols + w);
+    }
+
+    // Braid each row once the row below it is carved, while both are
+    // still in cache
+    for (y = 0; y < shape.h; y++) {
+        maze_carve_row(level->walls, &shape, y, &rng);
+        if (y > 0) {
+            maze_braid_row(level->walls, &shape, y - 1, &rng);
+        }
+    }
+    maze_braid_row(level->walls, &shape, shape.h - 1, &rng);
+
+    // Spawns: pac-man bottom middle, ghosts in the top corners, the middle
+    // and bottom left, like the built-in maze
+    int middle_col = 2 * (shape.half - 1) + 1;
+    level->pacman_start.row = 2 * shape.h - 1;
+    level->pacman_start.col = middle_col;
+    level->ghost_start[0].row = 1;
+    level->ghost_start[0].col = 1;
+    level->ghost_start[1].row = 1;
+    level->ghost_start[1].col = shape.mirror - 1;
+    level->ghost_start[2].row = 2 * (shape.h / 2) - 1;
+    level->ghost_start[2].col = middle_col;
+    level->ghost_start[3].row = 2 * shape.h - 1;
+    level->ghost_start[3].col = 1;
+
+    // Dots on every open cell except where pac-man starts
+    int cells = rows * cols;
+    for (i = 0; i < level->words; i++) {
+        level->dots[i] = ~level->walls[i];
+    }
+    if (cells % 64 != 0) {
+        level->dots[level->words - 1] &= ((uint64_t)1 << (cells % 64)) - 1;
+    }
+    int start = level_cell(level, level->pacman_start.row, level->pacman_start.col);
+    level->dots[start >> 6] &= ~((uint64_t)1 << (start & 63));
+    for (i = 0; i < level->words; i++) {
+        level->dot_count = level->dot_count + (unsigned int)count_bits(level->dots[i]);
+    }
+    if (find_wall_shapes(level) == false) {
+        level_free(level);
+        return false;
+    }
+    return true;
+}
+
+void level_free(struct Level *level) {
+    free(level->walls);
+    free(level->dots);
+    free(level->wall_shapes);
+    level->walls = NULL;
+    level->dots = NULL;
+    level->wall_shapes = NULL;
+}
+
+const struct Level *level_default() {
+    static struct Level level;
+    static bool loaded = false;
+
+    if (loaded == false) {
+        level_load(&level, LEVEL_TEMPLATE, MAP_HEIGHT, MAP_WIDTH);
+
+        level.pacman_start.row = 13;
+        level.pacman_start.col = 20;
+
+        // Red ghost (chaser) - top left
+        level.ghost_start[0].row = 1;
+        level.ghost_start[0].col = 1;
+        // Pink ghost (ambusher) - top right
+        level.ghost_start[1].row = 1;
+        level.ghost_start[1].col = 38;
+        // Cyan ghost (flanker) - center
+        level.ghost_start[2].row = 7;
+        level.ghost_start[2].col = 20;
+        // Orange ghost (random) - bottom
+        level.ghost_start[3].row = 11;
+        level.ghost_start[3].col = 10;
+
+        loaded = true;
+    }
+    return &level;
+}
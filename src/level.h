@@ -0,0 +1,80 @@
+/*
+ * Level data.
+ *
+ * A level is the read-only part of a game: the walls, where the dots start
+ * and where everyone spawns. It is built once and shared by every game
+ * session playing it, so each session only has to carry its own dots.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Position on the map
+struct Position {
+    int row;
+    int col;
+};
+
+// Size of the built-in maze
+#define MAP_HEIGHT 15
+#define MAP_WIDTH 40
+
+#define NUM_GHOSTS 4
+
+// Which neighbours of a wall are walls too (see level_wall_shape)
+#define WALL_UP    1
+#define WALL_DOWN  2
+#define WALL_LEFT  4
+#define WALL_RIGHT 8
+
+// Sizes level_generate can build
+#define LEVEL_MIN_SIZE 7
+#define LEVEL_MAX_SIZE 8192
+
+struct Level {
+    int rows;
+    int cols;
+    int words;                 // 64-bit words in each cell bit set
+    uint64_t *walls;           // Bit set: 1 = wall
+    uint64_t *dots;            // Bit set: 1 = dot at the start of the level
+    uint8_t *wall_shapes;      // 4 bits per cell: WALL_* neighbours, worked out once so
+                               // the renderer can join walls up without looking around
+    unsigned int dot_count;
+    struct Position pacman_start;
+    struct Position ghost_start[NUM_GHOSTS];
+    int number;                // Place in a campaign, from 1 (0 = not part of one)
+};
+
+// Build a level from text rows ('#' = wall, '.' = dot, anything else = floor)
+bool level_load(struct Level *level, const char *const *rows, int height, int width);
+
+// Build a random maze. The same seed always gives the same maze.
+// Corridors are all connected and have no dead ends, the left half mirrors
+// the right like the arcade maze, and everything but pac-man's spawn has
+// a dot. Each size must be between LEVEL_MIN_SIZE and LEVEL_MAX_SIZE.
+bool level_generate(struct Level *level, int rows, int cols, uint32_t seed);
+
+// Free a level built with level_load or level_generate
+void level_free(struct Level *level);
+
+// The built-in maze (built on first use, never freed)
+const struct Level *level_default();
+
+// Cell helpers for the bit sets
+static inline int level_cell(const struct Level *level, int row, int col) {
+    return row * level->cols + col;
+}
+
+static inline bool level_bit(const uint64_t *bits, int cell) {
+    return (bits[cell >> 6] >> (cell & 63)) & 1;
+}
+
+static inline bool level_is_wall(const struct Level *level, int row, int col) {
+    return level_bit(level->walls, level_cell(level, row, col));
+}
+
+static inline int level_wall_shape(const struct Level *level, int cell) {
+    return (level->wall_shapes[cell >> 1] >> ((cell & 1) * 4)) & 15;
+}
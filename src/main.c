@@ -1,60 +1,609 @@
 /*
  * Pac-Man Game
- * 
+ *
  * A simple console-based Pac-Man game.
  * Use WASD to move, R to restart, Q to quit.
+ *
+ * The game runs on two threads. The simulation thread owns the game: it
+ * applies key presses, moves the ghosts and publishes a snapshot whenever
+ * something changed. The main thread reads the keyboard and draws the
+ * newest snapshot, so a slow terminal never holds up the ghosts.
+ *
+ * With --host or --join two games on the same machine play each other:
+ * the host is pac-man and the player who joins steers the red ghost.
+ * The network thread then takes the simulation thread's place.
+ *
+ * A single-player game is a campaign: clearing a level moves on to the
+ * next, which a worker thread has already built in the background.
+ *
+ * With --share NAME the game thread also keeps a copy of the game state
+ * in shared memory for other processes (see shared_state.h).
  */
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
 
 #include "app.h"
+#include "atomics.h"
+#include "campaign.h"
+#include "leaderboard.h"
+#include "netplay.h"
 #include "platform.h"
+#include "recorder.h"
+#include "screen.h"
+#include "shared_state.h"
+#include "telemetry.h"
+#include "spsc_queue.h"
+#include "triple_buffer.h"
 
-// How often things happen (in milliseconds)
-#define GAME_TICK_MS    400   // Ghosts move every 400ms
-#define INPUT_POLL_MS   20    // Check for keyboard every 20ms
+// Longest the main loop sleeps with nothing to do (in milliseconds).
+// Keys, resizes and new frames wake it up sooner.
+#define MAIN_WAIT_MS    250
 
-int main() {
-    // Setup the terminal for the game
-    platform_init();
-    platform_enter_fullscreen();
+// --startup-trace: how long each step before the first frame took.
+// Steps that mostly wait on the terminal are marked, so the time the
+// game itself needs can be told apart from a slow terminal.
+#define STARTUP_MAX_STEPS 16
 
-    // Create the game
-    struct App app = app_create();
+struct StartupTrace {
+    bool enabled;
+    int count;
+    long long begin_ns;
+    long long last_ns;
+    const char *names[STARTUP_MAX_STEPS];
+    long long step_ns[STARTUP_MAX_STEPS];
+    bool terminal[STARTUP_MAX_STEPS];
+    int first_frame;              // Step that put the first frame on screen
+};
+
+struct StartupTrace g_startup;
+
+void startup_step(const char *name, bool terminal) {
+    long long now;
+    if (g_startup.enabled == false || g_startup.count == STARTUP_MAX_STEPS) {
+        return;
+    }
+    now = platform_time_ns();
+    g_startup.names[g_startup.count] = name;
+    g_startup.step_ns[g_startup.count] = now - g_startup.last_ns;
+    g_startup.terminal[g_startup.count] = terminal;
+    g_startup.count = g_startup.count + 1;
+    g_startup.last_ns = now;
+}
+
+void startup_print() {
+    long long total = 0, terminal = 0;
+    int i;
 
+    fprintf(stderr, "Startup:\n");
+    for (i = 0; i < g_startup.count; i++) {
+        total = total + g_startup.step_ns[i];
+        if (g_startup.terminal[i]) {
+            terminal = terminal + g_startup.step_ns[i];
+        }
+        fprintf(stderr, "  %-22s %9.3f ms %9.3f ms%s\n", g_startup.names[i],
+                g_startup.step_ns[i] / 1e6, total / 1e6, g_startup.terminal[i] ? "  (terminal)" : "");
+        if (i == g_startup.first_frame) {
+            fprintf(stderr, "Time to first frame: %.3f ms, %.3f ms without the terminal\n",
+                    total / 1e6, (total - terminal) / 1e6);
+        }
+    }
+}
+
+// Everything the two threads share
+struct GameThreads {
+    struct App *app;              // Only touched by the simulation thread (which swaps it between levels)
+    struct SpscQueue input;       // Keys: main thread -> simulation
+    struct TripleBuffer frames;   // Snapshots: simulation -> main thread
+    struct NetPlay *net;          // Two-player game, or NULL
+    struct Campaign *campaign;    // Levels after this one, or NULL
+    struct SharedStateWriter *share;  // --share, or NULL
+    volatile int running;
+};
+
+// Simulation thread: input, ghosts and publishing snapshots
+void simulation_thread(void *arg) {
+    struct GameThreads *game = arg;
+    struct App *app = game->app;
     long last_tick = platform_time_ms();
-    long last_poll = platform_time_ms();
+    long won_at = -1;
 
-    // Main game loop
-    while (app.running) {
+    telemetry_attach();
+    while (app->running) {
         long now = platform_time_ms();
+        int ch;
+
+        while (spsc_queue_pop(&game->input, &ch)) {
+            // Starting again goes back to the campaign's first level
+            if (game->campaign != NULL && (ch == 'r' || ch == 'R' || ch == ' ')) {
+                campaign_restart(game->campaign, app);
+            }
+            app_handle_input(app, ch);
+            if (app->running == false) {
+                break;
+            }
+        }
+
+        // Run every tick that is due (move ghosts, etc). After a long
+        // stall, skip ahead instead of racing through the backlog.
+        if (now - last_tick > 50 * APP_TICK_MS) {
+            last_tick = now - APP_TICK_MS;
+        }
+        while (now - last_tick >= APP_TICK_MS) {
+            app_tick(app);
+            last_tick = last_tick + APP_TICK_MS;
+        }
+
+        // A cleared level stays on screen for a moment, then the next
+        // one, built meanwhile, takes its place
+        if (game->campaign != NULL && app->won) {
+            if (won_at < 0) {
+                won_at = now;
+            } else if (now - won_at >= CAMPAIGN_PAUSE_MS) {
+                struct App *next = campaign_next(game->campaign, app);
+                if (next != NULL) {
+                    app = next;
+                    game->app = next;
+                    won_at = -1;
+                }
+            }
+        } else {
+            won_at = -1;
+        }
+
+        // Other processes get every tick, not only the ones that change
+        // the screen
+        if (game->share != NULL && (app->needs_redraw || app->timers.now != game->share->state->tick)) {
+            shared_state_publish(game->share, app);
+        }
+
+        if (app->needs_redraw) {
+            app->needs_redraw = false;
+            triple_buffer_publish(&game->frames, app);
+            platform_wake();
+        }
+
+        platform_sleep_ms(1);
+    }
+
+    atom_store(&game->running, 0);
+    platform_wake();
+}
+
+// Keys that go to the other player
+bool is_game_key(int ch) {
+    return ch > 0 && strchr("wasdWASDrR qQ", ch) != NULL;
+}
+
+// Network thread for two-player games: runs fixed ticks, swaps keys with
+// the other game and rolls back when its guesses were wrong
+void netplay_thread(void *arg) {
+    struct GameThreads *game = arg;
+    struct NetPlay *net = game->net;
+    struct App *app = game->app;
+    long long next_tick = platform_time_us();
+
+    telemetry_attach();
+    while (net->broken == false && net->remote_quit == false && net->stats.desync_tick < 0) {
+        long long now = platform_time_us();
 
-        // Check for keyboard input
-        if (now - last_poll >= INPUT_POLL_MS) {
-            while (platform_kbhit()) {
-                int ch = platform_getch();
-                app_handle_input(&app, ch);
-                if (app.running == false) {
+        netplay_receive(net);
+
+        if (now >= next_tick) {
+            if (netplay_can_advance(net)) {
+                int key = 0;
+                while (spsc_queue_pop(&game->input, &key) && is_game_key(key) == false) {
+                    key = 0;
+                }
+                if (key == 'q' || key == 'Q') {
+                    netplay_quit(net);
                     break;
                 }
+                netplay_advance(net, key);
+            } else {
+                net->stats.stalls = net->stats.stalls + 1;
+            }
+            next_tick = next_tick + NET_TICK_MS * 1000;
+            // After a long pause, carry on from now instead of catching up
+            if (now - next_tick > 10 * NET_TICK_MS * 1000) {
+                next_tick = now;
             }
-            last_poll = now;
         }
+        netplay_flush(net);
 
-        // Update game (move ghosts, etc)
-        if (now - last_tick >= GAME_TICK_MS) {
-            app_update(&app);
-            last_tick = now;
+        if (game->share != NULL && (app->needs_redraw || app->timers.now != game->share->state->tick)) {
+            shared_state_publish(game->share, app);
         }
 
-        // Draw the game
-        app_render(&app);
+        if (app->needs_redraw) {
+            app->needs_redraw = false;
+            triple_buffer_publish(&game->frames, app);
+            platform_wake();
+        }
+
+        platform_sleep_ms(1);
+    }
+
+    atom_store(&game->running, 0);
+    platform_wake();
+}
+
+void print_usage(const char *program) {
+    fprintf(stderr, "Usage: %s [--record FILE.cast[.gz]] [--maze ROWSxCOLS[:SEED]]\n"
+                    "          [--host SOCKET | --join SOCKET] [--telemetry FILE]\n"
+                    "          [--ai-detail full|fixed:FAR_GHOSTS|timed:MICROSECONDS]\n"
+                    "          [--render 16|256|truecolor,ascii|unicode,rep|norep] [--share NAME]\n"
+                    "          [--startup-trace]\n", program);
+}
+
+int main(int argc, char **argv) {
+    const char *record_path = NULL;
+    const char *telemetry_path = NULL;
+    const char *host_path = NULL;
+    const char *join_path = NULL;
+    const char *share_name = NULL;
+    const struct Level *level = level_default();
+    static struct Level maze;
+    static struct NetPlay net;
+    static struct GhostParams params;
+    static struct Campaign campaign;
+    static struct SharedStateWriter share;
+    struct ScreenCaps caps;
+    struct NetHello hello;
+    bool generated = false;
+    uint32_t maze_seed = (uint32_t)time(NULL);
+    int i;
+
+    g_startup.begin_ns = platform_time_ns();
+    g_startup.last_ns = g_startup.begin_ns;
+    g_startup.first_frame = -1;
+    memset(&hello, 0, sizeof(hello));
+    params = GHOST_PARAMS_DEFAULT;
+    screen_detect(&caps);
+
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+            record_path = argv[i + 1];
+            i = i + 1;
+        } else if (strcmp(argv[i], "--maze") == 0 && i + 1 < argc) {
+            int maze_rows = 0, maze_cols = 0;
+            unsigned int seed = (unsigned int)time(NULL);
+            if (sscanf(argv[i + 1], "%dx%d:%u", &maze_rows, &maze_cols, &seed) < 2) {
+                print_usage(argv[0]);
+                return 1;
+            }
+            hello.maze_rows = maze_rows;
+            hello.maze_cols = maze_cols;
+            hello.maze_seed = seed;
+            maze_seed = seed;
+            if (level_generate(&maze, maze_rows, maze_cols, seed) == false) {
+                fprintf(stderr, "Error: maze size must be %dx%d to %dx%d\n",
+                        LEVEL_MIN_SIZE, LEVEL_MIN_SIZE, LEVEL_MAX_SIZE, LEVEL_MAX_SIZE);
+                return 1;
+            }
+            level = &maze;
+            generated = true;
+            i = i + 1;
+        } else if (strcmp(argv[i], "--host") == 0 && i + 1 < argc) {
+            host_path = argv[i + 1];
+            i = i + 1;
+        } else if (strcmp(argv[i], "--join") == 0 && i + 1 < argc) {
+            join_path = argv[i + 1];
+            i = i + 1;
+        } else if (strcmp(argv[i], "--ai-detail") == 0 && i + 1 < argc) {
+            if (ghost_params_parse_detail(&params, argv[i + 1]) == false) {
+                print_usage(argv[0]);
+                return 1;
+            }
+            i = i + 1;
+        } else if (strcmp(argv[i], "--telemetry") == 0 && i + 1 < argc) {
+            telemetry_path = argv[i + 1];
+            i = i + 1;
+        } else if (strcmp(argv[i], "--render") == 0 && i + 1 < argc) {
+            if (screen_parse_caps(&caps, argv[i + 1]) == false) {
+                print_usage(argv[0]);
+                return 1;
+            }
+            i = i + 1;
+        } else if (strcmp(argv[i], "--share") == 0 && i + 1 < argc) {
+            share_name = argv[i + 1];
+            i = i + 1;
+        } else if (strcmp(argv[i], "--startup-trace") == 0) {
+            g_startup.enabled = true;
+        } else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    startup_step("arguments", false);
+
+    // Find the other player before taking over the terminal
+    if (host_path != NULL && join_path != NULL) {
+        print_usage(argv[0]);
+        return 1;
+    }
+    if ((host_path != NULL || join_path != NULL) && params.detail == AI_DETAIL_TIMED) {
+        fprintf(stderr, "Error: two-player games need the same ghost moves on both sides, use --ai-detail fixed:N\n");
+        return 1;
+    }
+    if (host_path != NULL) {
+        hello.seed = (uint32_t)time(NULL);
+        hello.ai_detail = params.detail;
+        hello.ai_budget = params.detail_budget;
+        fprintf(stderr, "Waiting for the other player on %s...\n", host_path);
+        if (netplay_host(&net, host_path, &hello) == false) {
+            fprintf(stderr, "Error: could not host on %s\n", host_path);
+            return 1;
+        }
+    }
+    if (join_path != NULL) {
+        if (generated || netplay_join(&net, join_path, &hello) == false) {
+            fprintf(stderr, "Error: could not join the game on %s\n", join_path);
+            return 1;
+        }
+        // The host picks the ghost AI detail too
+        params.detail = hello.ai_detail;
+        params.detail_budget = hello.ai_budget;
+        // The host picks the maze
+        if (hello.maze_rows > 0) {
+            if (level_generate(&maze, hello.maze_rows, hello.maze_cols, hello.maze_seed) == false) {
+                fprintf(stderr, "Error: out of memory\n");
+                return 1;
+            }
+            level = &maze;
+            generated = true;
+        }
+    }
+
+    if (host_path != NULL || join_path != NULL) {
+        startup_step("other player", false);
+    }
+
+    if (telemetry_path != NULL) {
+        if (telemetry_start(telemetry_path) == false) {
+            return 1;
+        }
+        startup_step("telemetry", false);
+    }
+
+    // Setup the terminal for the game
+    platform_init();
+    startup_step("terminal setup", true);
+
+    // Start recording before anything is drawn
+    if (record_path != NULL) {
+        int rows, cols;
+        platform_get_terminal_size(&rows, &cols);
+        if (recorder_start(record_path, rows, cols) == false) {
+            return 1;
+        }
+        startup_step("recorder", false);
+    }
+
+    platform_enter_fullscreen();
+    startup_step("fullscreen", true);
+
+    // Create the game
+    static struct GameThreads game;
+    game.app = app_create(level);
+    if (game.app == NULL || triple_buffer_create(&game.frames, game.app->level) == false) {
+        platform_exit_fullscreen();
+        fprintf(stderr, "Error: out of memory\n");
+        return 1;
+    }
+    app_set_params(game.app, &params);
+    spsc_queue_init(&game.input);
+    game.running = 1;
+
+    // Both games start from the host's seed. Sound would play again on
+    // every rollback, so two-player games are silent.
+    if (host_path != NULL || join_path != NULL) {
+        game.app->flags = game.app->flags | APP_HEADLESS;
+        app_seed(game.app, hello.seed);
+    }
+    startup_step("game created", false);
+
+    // Screen buffer for this thread
+    static struct Renderer renderer;
+    int rows, cols;
+    platform_get_terminal_size(&rows, &cols);
+    renderer_init(&renderer, &caps);
+    renderer_resize(&renderer, rows, cols);
+
+    // Draw the first frame straight away. No other thread has the game
+    // yet, so there's no need to wait for a snapshot.
+    int first_len = app_render(game.app, &renderer);
+    startup_step("first frame drawn", false);
+    platform_write(renderer.frame_buffer, first_len);
+    platform_output_flush();
+    startup_step("first frame written", true);
+    g_startup.first_frame = g_startup.count - 1;
+
+    // Everything from here on can wait until the player sees the maze
+    app_load_high_score(game.app);
+    startup_step("high score", false);
+
+    if (host_path != NULL || join_path != NULL) {
+        if (netplay_start(&net, game.app) == false) {
+            platform_exit_fullscreen();
+            fprintf(stderr, "Error: out of memory\n");
+            return 1;
+        }
+        game.net = &net;
+    } else {
+        // Two-player games stay on one level: the two sides would have to
+        // agree on when the next one is ready
+        if (campaign_start(&campaign, level, &params, maze_seed, game.app) == false) {
+            platform_exit_fullscreen();
+            fprintf(stderr, "Error: out of memory\n");
+            return 1;
+        }
+        game.campaign = &campaign;
+        startup_step("campaign", false);
+    }
+
+    if (share_name != NULL) {
+        if (shared_state_create(&share, share_name, level) == false) {
+            platform_exit_fullscreen();
+            fprintf(stderr, "Error: could not share the game as %s\n", share_name);
+            return 1;
+        }
+        shared_state_publish(&share, game.app);
+        game.share = &share;
+        startup_step("shared state", false);
+    }
+
+    struct PlatformThread *sim = platform_thread_start(game.net != NULL ? netplay_thread : simulation_thread, &game);
+    if (sim == NULL) {
+        platform_exit_fullscreen();
+        fprintf(stderr, "Error: could not start the game thread\n");
+        return 1;
+    }
+    startup_step("game thread", false);
+
+    if (game.net == NULL) {
+        platform_play_sound(SOUND_START);
+        startup_step("start sound", false);
+    }
+
+    int held_key = -1;            // Key read while the input queue was full
+    bool repaint = false;
+    unsigned long frames_dropped = 0;
+    struct PlatformOutputStats out_stats;
+
+    // Main loop: keyboard in, frames out. It sleeps until a key comes
+    // in, the terminal is resized or the game thread has a new frame.
+    while (atom_load(&game.running)) {
+        // Hand keys to the game thread as soon as they come in. If the
+        // game thread has fallen so far behind that the queue is full,
+        // the key waits here (and the ones after it in the terminal)
+        // until there is room, so no key, 'q' least of all, is lost.
+        if (held_key != -1 && spsc_queue_push(&game.input, held_key)) {
+            held_key = -1;
+        }
+        while (held_key == -1 && platform_kbhit()) {
+            int ch = platform_getch();
+            if (ch != -1 && spsc_queue_push(&game.input, ch) == false) {
+                held_key = ch;
+            }
+            if (ch == 'q' || ch == 'Q') {
+                break;
+            }
+        }
+
+        // A resize redraws the current snapshot in full with the new layout
+        if (platform_poll_resize()) {
+            platform_get_terminal_size(&rows, &cols);
+            renderer_resize(&renderer, rows, cols);
+            repaint = true;
+        }
+
+        // Draw the newest snapshot, if there is one. A frame only carries
+        // what changed since the one before, so it mustn't replace one
+        // still waiting for the terminal: wait until that has gone out.
+        // Snapshots published meanwhile are skipped, as before.
+        if (triple_buffer_acquire(&game.frames)) {
+            repaint = true;
+        }
+        platform_output_stats(&out_stats);
+        if (repaint && out_stats.bytes_queued == 0) {
+            if (out_stats.frames_dropped != frames_dropped) {
+                frames_dropped = out_stats.frames_dropped;
+                renderer_invalidate(&renderer);
+            }
+            int len = app_render(triple_buffer_front(&game.frames), &renderer);
+            if (len > 0) {
+                platform_write(renderer.frame_buffer, len);
+            }
+            repaint = false;
+        }
+        platform_output_flush();
+
+        // A held key has nothing to wake us when the queue frees up, so
+        // it is retried every millisecond
+        platform_wait_input(held_key != -1 ? 1 : MAIN_WAIT_MS);
     }
 
     // Clean up
-    app_destroy(&app);
+    platform_thread_join(sim);
+    if (game.share != NULL) {
+        shared_state_destroy(&share);
+    }
+    triple_buffer_destroy(&game.frames);
+    uint32_t ai_full = game.app->ai_full;
+    uint32_t ai_cheap = game.app->ai_cheap;
+    app_destroy(game.app);
+    struct CampaignStats campaign_stats;
+    if (game.campaign != NULL) {
+        campaign_stop(&campaign, &campaign_stats);
+    }
+    leaderboard_close();
+    if (generated) {
+        level_free(&maze);
+    }
+
+    struct TelemetryStats telemetry_stats;
+    if (telemetry_path != NULL) {
+        telemetry_stop(&telemetry_stats);
+    }
+
+    struct RecorderStats record_stats;
+    if (record_path != NULL) {
+        platform_output_drain();
+        recorder_stop(&record_stats);
+    }
     platform_exit_fullscreen();
 
+    if (game.net != NULL) {
+        if (net.stats.desync_tick >= 0) {
+            fprintf(stderr, "Error: the games went out of sync at tick %ld\n", net.stats.desync_tick);
+        } else if (net.broken) {
+            fprintf(stderr, "Lost the connection to the other player\n");
+        } else if (net.remote_quit) {
+            fprintf(stderr, "The other player quit\n");
+        }
+        fprintf(stderr, "%lu ticks, %lu rollbacks (%lu ticks replayed, at most %d at once), %lu ticks waiting\n",
+                net.stats.ticks, net.stats.rollbacks, net.stats.resimulated,
+                net.stats.max_rollback, net.stats.stalls);
+        netplay_close(&net);
+    }
+
+    if (record_path != NULL) {
+        fprintf(stderr, "Recorded %llu bytes to %s (%llu bytes on disk, %llu bytes dropped)\n",
+                (unsigned long long)record_stats.bytes_recorded, record_path,
+                (unsigned long long)record_stats.file_bytes,
+                (unsigned long long)record_stats.bytes_dropped);
+    }
+    if (game.campaign != NULL && campaign_stats.built > 0) {
+        fprintf(stderr, "Reached level %d. Built %d levels in the background (%.2f ms on average, %.2f ms at most);\n"
+                        "changing level took %.1f us at most on the game thread, %d level changes waited for the builder\n",
+                campaign_stats.highest, campaign_stats.built,
+                campaign_stats.build_ns / 1e6 / campaign_stats.built, campaign_stats.build_max_ns / 1e6,
+                campaign_stats.swap_max_ns / 1e3, campaign_stats.late);
+    }
+    if (atom_load(&campaign.failed)) {
+        fprintf(stderr, "Error: ran out of memory building level %d\n", campaign_stats.level + 1);
+    }
+    char leaderboard_path[512];
+    if (platform_get_highscore_path(leaderboard_path, sizeof(leaderboard_path)) == false) {
+        fprintf(stderr, "No home directory to keep the leaderboard in: scores were not saved "
+                        "(set PACMAN_LEADERBOARD to a file to keep them)\n");
+    }
+    if (params.detail != AI_DETAIL_FULL) {
+        fprintf(stderr, "Ghost AI: %u proper decisions, %u cheap ones\n", ai_full, ai_cheap);
+    }
+    if (g_startup.enabled) {
+        startup_print();
+    }
+    if (telemetry_path != NULL) {
+        fprintf(stderr, "Logged %llu events to %s (%llu bytes, %llu events dropped)\n",
+                (unsigned long long)telemetry_stats.events, telemetry_path,
+                (unsigned long long)telemetry_stats.file_bytes,
+                (unsigned long long)telemetry_stats.dropped);
+    }
+
     return 0;
 }
@@ -0,0 +1,326 @@
+#include "netplay.h"
+#include "platform.h"
+#include "telemetry.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NET_MAGIC 0x504e4d50u  // "PMNP"
+#define NET_VERSION 2
+
+// How long the handshake waits for the other side
+#define NET_HANDSHAKE_MS 5000
+
+// Send or receive a whole block during the handshake
+bool handshake_send(int sock, const void *data, int len) {
+    long deadline = platform_time_ms() + NET_HANDSHAKE_MS;
+    int done = 0;
+    while (done < len && platform_time_ms() < deadline) {
+        int n = platform_socket_send(sock, (const char *)data + done, len - done);
+        if (n < 0) {
+            return false;
+        }
+        done = done + n;
+        if (n == 0) {
+            platform_sleep_ms(1);
+        }
+    }
+    return done == len;
+}
+
+bool handshake_recv(int sock, void *data, int len) {
+    long deadline = platform_time_ms() + NET_HANDSHAKE_MS;
+    int done = 0;
+    while (done < len && platform_time_ms() < deadline) {
+        int n = platform_socket_recv(sock, (char *)data + done, len - done);
+        if (n < 0) {
+            return false;
+        }
+        done = done + n;
+        if (n == 0) {
+            platform_sleep_ms(1);
+        }
+    }
+    return done == len;
+}
+
+void netplay_setup(struct NetPlay *net, int sock, int role) {
+    const char *delay = getenv("PACMAN_NET_DELAY_MS");
+
+    memset(net, 0, sizeof(*net));
+    net->sock = sock;
+    net->role = role;
+    net->stats.desync_tick = -1;
+    if (delay != NULL) {
+        net->delay_ms = atoi(delay);
+    }
+}
+
+bool netplay_host(struct NetPlay *net, const char *path, const struct NetHello *hello) {
+    struct NetHello msg = *hello;
+    int sock = platform_local_accept(path);
+
+    netplay_setup(net, sock, NET_ROLE_PACMAN);
+    if (sock < 0) {
+        return false;
+    }
+    msg.magic = NET_MAGIC;
+    msg.version = NET_VERSION;
+    return handshake_send(sock, &msg, sizeof(msg));
+}
+
+bool netplay_join(struct NetPlay *net, const char *path, struct NetHello *hello) {
+    int sock = platform_local_connect(path);
+
+    netplay_setup(net, sock, NET_ROLE_GHOST);
+    if (sock < 0) {
+        return false;
+    }
+    if (handshake_recv(sock, hello, sizeof(*hello)) == false) {
+        return false;
+    }
+    return hello->magic == NET_MAGIC && hello->version == NET_VERSION;
+}
+
+bool netplay_start(struct NetPlay *net, struct App *app) {
+    net->app = app;
+    net->stride = app_session_size(app->level);
+    net->snapshots = malloc(net->stride * NET_WINDOW);
+    if (net->snapshots == NULL) {
+        return false;
+    }
+
+    // The other player moves this ghost, so the AI leaves it alone
+    app->player_ghost = GHOST_CHASER;
+    timer_wheel_cancel(&app->timers, TIMER_GHOST + GHOST_CHASER);
+    return true;
+}
+
+// Saved state from before tick `t`
+struct App *snapshot(struct NetPlay *net, int t) {
+    return (struct App *)(net->snapshots + (size_t)(t % NET_WINDOW) * net->stride);
+}
+
+// Simulate tick `tick` from the current state, saving the state first
+void run_tick(struct NetPlay *net) {
+    int t = net->tick;
+    int slot = t % NET_WINDOW;
+    struct App *app = net->app;
+
+    memcpy(snapshot(net, t), app, net->stride);
+
+    // Guess that the other side pressed nothing if we don't know yet
+    int remote = t < net->remote_count ? net->remote_keys[t % (2 * NET_WINDOW)] : 0;
+    net->used_keys[slot] = remote;
+
+    int pacman_key = net->role == NET_ROLE_PACMAN ? net->local_keys[slot] : remote;
+    int ghost_key = net->role == NET_ROLE_PACMAN ? remote : net->local_keys[slot];
+
+    // Pac-man always goes first so both sides agree on the order
+    if (pacman_key == 'r' || pacman_key == 'R' || pacman_key == ' ' ||
+        ghost_key == 'r' || ghost_key == 'R' || ghost_key == ' ') {
+        app_handle_input(app, 'r');
+    } else {
+        if (pacman_key != 0) {
+            app_handle_input(app, pacman_key);
+        }
+        if (ghost_key != 0) {
+            app_move_ghost(app, ghost_key);
+        }
+    }
+    app_tick(app);
+
+    net->tick = t + 1;
+}
+
+// Go back to the start of tick `from` and simulate up to now again
+void rollback(struct NetPlay *net, int from) {
+    int end = net->tick;
+
+    // These ticks were logged when they were first played, so telemetry
+    // is off for this thread until they have been played again
+    struct TelemetryBuffer *telemetry = t_telemetry;
+    t_telemetry = NULL;
+
+    memcpy(net->app, snapshot(net, from), net->stride);
+    net->tick = from;
+    while (net->tick < end) {
+        run_tick(net);
+    }
+    net->app->needs_redraw = true;
+    t_telemetry = telemetry;
+
+    net->stats.rollbacks = net->stats.rollbacks + 1;
+    net->stats.resimulated = net->stats.resimulated + (unsigned long)(end - from);
+    if (end - from > net->stats.max_rollback) {
+        net->stats.max_rollback = end - from;
+    }
+}
+
+// Checksum of the state after tick `t`, which must be in the window
+uint32_t checksum_after(struct NetPlay *net, int t) {
+    if (t + 1 == net->tick) {
+        return app_checksum(net->app);
+    }
+    return app_checksum(snapshot(net, t + 1));
+}
+
+// Compare the other side's checksum with ours once we have the same tick
+void check_remote_checksum(struct NetPlay *net) {
+    if (net->remote_checksum_pending == false) {
+        return;
+    }
+    int t = (int)net->remote_checksum.checksum_tick;
+    if (t >= net->tick || t >= net->remote_count) {
+        return;  // Not there yet
+    }
+    net->remote_checksum_pending = false;
+    if (t + 1 <= net->tick - NET_WINDOW) {
+        return;  // Too old to check
+    }
+    if (checksum_after(net, t) != net->remote_checksum.checksum && net->stats.desync_tick < 0) {
+        net->stats.desync_tick = t;
+    }
+}
+
+void queue_packet(struct NetPlay *net, const struct NetPacket *packet, int delay_ms) {
+    if (net->outbox_count == NET_OUTBOX_SIZE) {
+        net->broken = true;
+        return;
+    }
+    int slot = (net->outbox_head + net->outbox_count) % NET_OUTBOX_SIZE;
+    net->outbox[slot] = *packet;
+    net->outbox_due[slot] = platform_time_us() + (long long)delay_ms * 1000;
+    net->outbox_count = net->outbox_count + 1;
+}
+
+void netplay_receive(struct NetPlay *net) {
+    int rollback_from = -1;
+
+    while (net->broken == false) {
+        int n = platform_socket_recv(net->sock, net->inbox + net->inbox_len,
+                                     (int)sizeof(net->inbox) - net->inbox_len);
+        if (n < 0) {
+            net->broken = true;
+            break;
+        }
+        if (n == 0) {
+            break;
+        }
+        net->inbox_len = net->inbox_len + n;
+        if (net->inbox_len < (int)sizeof(struct NetPacket)) {
+            continue;
+        }
+
+        struct NetPacket packet;
+        memcpy(&packet, net->inbox, sizeof(packet));
+        net->inbox_len = 0;
+
+        if (packet.tick == NET_QUIT_TICK) {
+            net->remote_quit = true;
+            break;
+        }
+
+        // Packets arrive in order, one per tick
+        int t = (int)packet.tick;
+        if (t != net->remote_count) {
+            net->broken = true;
+            break;
+        }
+        net->remote_keys[t % (2 * NET_WINDOW)] = packet.key;
+        net->remote_count = t + 1;
+
+        // We already simulated this tick with a guess. Was it right?
+        if (t < net->tick && net->used_keys[t % NET_WINDOW] != packet.key && rollback_from < 0) {
+            rollback_from = t;
+        }
+
+        if (packet.checksum_tick != NET_NO_CHECKSUM) {
+            net->remote_checksum = packet;
+            net->remote_checksum_pending = true;
+        }
+    }
+
+    if (rollback_from >= 0) {
+        rollback(net, rollback_from);
+    }
+    check_remote_checksum(net);
+}
+
+bool netplay_can_advance(const struct NetPlay *net) {
+    return net->tick - net->remote_count < NET_WINDOW - 1;
+}
+
+void netplay_advance(struct NetPlay *net, int key) {
+    struct NetPacket packet;
+    int t = net->tick;
+
+    net->local_keys[t % NET_WINDOW] = key;
+    run_tick(net);
+    net->stats.ticks = net->stats.ticks + 1;
+
+    // Send our key, with the checksum of the newest tick both keys are in
+    int agreed = (net->remote_count < net->tick ? net->remote_count : net->tick) - 1;
+    packet.tick = (uint32_t)t;
+    packet.key = key;
+    packet.checksum_tick = NET_NO_CHECKSUM;
+    packet.checksum = 0;
+    if (agreed >= 0) {
+        packet.checksum_tick = (uint32_t)agreed;
+        packet.checksum = checksum_after(net, agreed);
+    }
+    queue_packet(net, &packet, net->delay_ms);
+
+    check_remote_checksum(net);
+}
+
+void netplay_flush(struct NetPlay *net) {
+    long long now = platform_time_us();
+
+    while (net->outbox_count > 0 && net->broken == false) {
+        int slot = net->outbox_head;
+        if (net->outbox_due[slot] > now) {
+            break;
+        }
+
+        const char *bytes = (const char *)&net->outbox[slot];
+        int left = (int)sizeof(struct NetPacket) - net->outbox_sent;
+        int n = platform_socket_send(net->sock, bytes + net->outbox_sent, left);
+        if (n < 0) {
+            net->broken = true;
+            break;
+        }
+        net->outbox_sent = net->outbox_sent + n;
+        if (n < left) {
+            break;  // Socket is full, try again later
+        }
+
+        net->outbox_sent = 0;
+        net->outbox_head = (net->outbox_head + 1) % NET_OUTBOX_SIZE;
+        net->outbox_count = net->outbox_count - 1;
+    }
+}
+
+void netplay_quit(struct NetPlay *net) {
+    struct NetPacket packet;
+    long deadline = platform_time_ms() + 200;
+
+    memset(&packet, 0, sizeof(packet));
+    packet.tick = NET_QUIT_TICK;
+    queue_packet(net, &packet, 0);
+
+    // The quit goes out after anything still held back by the delay
+    // shim, so don't wait forever for it
+    while (net->outbox_count > 0 && net->broken == false && platform_time_ms() < deadline) {
+        netplay_flush(net);
+        platform_sleep_ms(1);
+    }
+}
+
+void netplay_close(struct NetPlay *net) {
+    platform_socket_close(net->sock);
+    free(net->snapshots);
+    net->sock = -1;
+    net->snapshots = NULL;
+}
@@ -0,0 +1,127 @@
+/*
+ * Two-player games over a local socket, with rollback.
+ *
+ * One player is pac-man and the other steers the red ghost. Both games
+ * run the whole simulation and only send each other their key for each
+ * tick. When the other player's key for a tick hasn't arrived yet we
+ * guess that they pressed nothing and carry on, so your own keys always
+ * show up on the next tick. If the guess was wrong, we go back to the
+ * saved state from before that tick and replay from there with the real
+ * key. Saving a state is one memcpy of the session.
+ *
+ * Each packet also carries a checksum of a tick both sides agree on,
+ * so if the games ever drift apart we notice straight away.
+ *
+ * Set PACMAN_NET_DELAY_MS to hold back every packet we send by that
+ * many milliseconds (for testing slow links).
+ */
+
+#pragma once
+
+#include "app.h"
+
+// Length of one simulation tick
+#define NET_TICK_MS APP_TICK_MS
+
+// How many ticks we can roll back. If the other side falls this far
+// behind, we wait for it.
+#define NET_WINDOW 128
+
+#define NET_ROLE_PACMAN 0
+#define NET_ROLE_GHOST 1
+
+// What the host tells the player that joins
+struct NetHello {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t seed;          // Game seed
+    int32_t maze_rows;      // 0 = built-in maze
+    int32_t maze_cols;
+    uint32_t maze_seed;
+    int32_t ai_detail;      // Ghost AI level of detail (AI_DETAIL_FULL or _FIXED)
+    int32_t ai_budget;
+};
+
+struct NetStats {
+    unsigned long ticks;
+    unsigned long rollbacks;
+    unsigned long resimulated;      // Ticks simulated again after a rollback
+    int max_rollback;               // Most ticks rolled back at once
+    unsigned long stalls;           // Ticks we waited for the other side
+    long desync_tick;               // First tick that didn't match, or -1
+};
+
+// One packet per tick, plus a quit packet (tick = NET_QUIT_TICK)
+#define NET_QUIT_TICK 0xffffffffu
+#define NET_NO_CHECKSUM 0xffffffffu
+
+struct NetPacket {
+    uint32_t tick;
+    int32_t key;
+    uint32_t checksum_tick;         // NET_NO_CHECKSUM if none yet
+    uint32_t checksum;
+};
+
+// Packets held back by PACMAN_NET_DELAY_MS
+#define NET_OUTBOX_SIZE 1024
+
+struct NetPlay {
+    int sock;
+    int role;
+    struct App *app;                // The game at `tick`
+
+    unsigned char *snapshots;       // State before each tick in the window
+    size_t stride;
+
+    int tick;                       // Next tick to simulate
+    int remote_count;               // Other side's keys we have (ticks 0 .. remote_count-1)
+    int local_keys[NET_WINDOW];
+    int used_keys[NET_WINDOW];      // The other side's key we simulated with
+    int remote_keys[2 * NET_WINDOW];  // Twice as long: the other side can be a window ahead
+
+    // Latest checksum from the other side
+    bool remote_checksum_pending;
+    struct NetPacket remote_checksum;
+
+    // Outgoing packets, sent once they are due
+    struct NetPacket outbox[NET_OUTBOX_SIZE];
+    long long outbox_due[NET_OUTBOX_SIZE];
+    int outbox_head;
+    int outbox_count;
+    int outbox_sent;                // Bytes of the head packet already sent
+    int delay_ms;
+
+    // Partly received packet
+    unsigned char inbox[sizeof(struct NetPacket)];
+    int inbox_len;
+
+    bool remote_quit;
+    bool broken;                    // Connection lost
+    struct NetStats stats;
+};
+
+// Wait for a player to join on `path` and send them the game settings
+bool netplay_host(struct NetPlay *net, const char *path, const struct NetHello *hello);
+
+// Join a game on `path` and get its settings
+bool netplay_join(struct NetPlay *net, const char *path, struct NetHello *hello);
+
+// Start playing `app` (already set up from the hello on both sides)
+bool netplay_start(struct NetPlay *net, struct App *app);
+
+// Read what the other side sent, rolling back if a guess was wrong
+void netplay_receive(struct NetPlay *net);
+
+// Can we run another tick, or are we too far ahead of the other side?
+bool netplay_can_advance(const struct NetPlay *net);
+
+// Run one tick with our key for it (0 = none)
+void netplay_advance(struct NetPlay *net, int key);
+
+// Send whatever is due. Call often.
+void netplay_flush(struct NetPlay *net);
+
+// Tell the other side we are leaving
+void netplay_quit(struct NetPlay *net);
+
+void netplay_close(struct NetPlay *net);
@@ -6,6 +6,7 @@
  */
 
 #include "platform.h"
+#include "atomics.h"
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -22,6 +23,134 @@ const char *get_sound_filename(SoundType type) {
     return NULL;
 }
 
+// Terminal size, updated only when the terminal tells us it changed
+int g_term_rows = 24;
+int g_term_cols = 80;
+
+// Ask the OS for the terminal size (one per OS below)
+void query_terminal_size(int *rows, int *cols);
+
+void platform_get_terminal_size(int *rows, int *cols) {
+    *rows = g_term_rows;
+    *cols = g_term_cols;
+}
+
+/* ============================================================
+ * SCREEN OUTPUT
+ *
+ * Frames are written without blocking. If the terminal is still busy
+ * with the last frame, the new one waits behind it, and a newer frame
+ * after that replaces the waiting one (it would be stale anyway).
+ * ============================================================ */
+
+// Begin/end synchronized update: the terminal shows the frame all at once
+#define SYNC_BEGIN "\033[?2026h"
+#define SYNC_END   "\033[?2026l"
+
+struct OutputBuffer {
+    char *data;
+    int len;
+    int sent;
+    int cap;
+};
+
+struct OutputBuffer g_out_current;   // Frame being written
+struct OutputBuffer g_out_pending;   // Newest frame waiting its turn
+bool g_out_has_pending = false;
+bool g_sync_output = false;          // Terminal understands SYNC_BEGIN/END
+struct PlatformOutputStats g_out_stats;
+void (*g_output_tap)(const char *buf, int len) = NULL;
+
+// Write as much as the terminal takes right now (one per OS below).
+// Returns bytes written, 0 if it would block, -1 on error.
+int os_write_some(const char *buf, int len);
+
+// Store a frame in a buffer, wrapped in sync markers if we can
+bool output_store(struct OutputBuffer *out, const char *buf, int len) {
+    int need = len + (int)(strlen(SYNC_BEGIN) + strlen(SYNC_END));
+    if (need > out->cap) {
+        char *data = realloc(out->data, (size_t)need);
+        if (data == NULL) return false;
+        out->data = data;
+        out->cap = need;
+    }
+
+    out->len = 0;
+    out->sent = 0;
+    if (g_sync_output) {
+        memcpy(out->data, SYNC_BEGIN, strlen(SYNC_BEGIN));
+        out->len = (int)strlen(SYNC_BEGIN);
+    }
+    memcpy(out->data + out->len, buf, (size_t)len);
+    out->len = out->len + len;
+    if (g_sync_output) {
+        memcpy(out->data + out->len, SYNC_END, strlen(SYNC_END));
+        out->len = out->len + (int)strlen(SYNC_END);
+    }
+    return true;
+}
+
+void platform_write(const char *buf, int len) {
+    if (g_out_current.sent < g_out_current.len) {
+        // Still busy: this frame waits, replacing any older waiting one
+        if (g_out_has_pending) {
+            g_out_stats.frames_dropped = g_out_stats.frames_dropped + 1;
+        }
+        g_out_has_pending = output_store(&g_out_pending, buf, len);
+    } else {
+        output_store(&g_out_current, buf, len);
+    }
+    platform_output_flush();
+}
+
+bool platform_output_flush() {
+    while (true) {
+        if (g_out_current.sent < g_out_current.len) {
+            int n = os_write_some(g_out_current.data + g_out_current.sent,
+                                  g_out_current.len - g_out_current.sent);
+            if (n == 0) {
+                return false;
+            }
+            if (n < 0) {
+                // The terminal is gone; forget the frame
+                g_out_current.sent = g_out_current.len;
+            } else {
+                if (g_output_tap != NULL) {
+                    g_output_tap(g_out_current.data + g_out_current.sent, n);
+                }
+                g_out_current.sent = g_out_current.sent + n;
+                g_out_stats.bytes_written = g_out_stats.bytes_written + (unsigned long)n;
+            }
+            if (g_out_current.sent == g_out_current.len) {
+                g_out_stats.frames_written = g_out_stats.frames_written + 1;
+            }
+            continue;
+        }
+
+        if (g_out_has_pending == false) {
+            return true;
+        }
+
+        // Start on the waiting frame
+        struct OutputBuffer done = g_out_current;
+        g_out_current = g_out_pending;
+        g_out_pending = done;
+        g_out_has_pending = false;
+    }
+}
+
+void platform_set_output_tap(void (*tap)(const char *buf, int len)) {
+    g_output_tap = tap;
+}
+
+void platform_output_stats(struct PlatformOutputStats *stats) {
+    *stats = g_out_stats;
+    stats->bytes_queued = g_out_current.len - g_out_current.sent;
+    if (g_out_has_pending) {
+        stats->bytes_queued = stats->bytes_queued + g_out_pending.len;
+    }
+}
+
 /* ============================================================
  * WINDOWS CODE
  * ============================================================ */
@@ -32,12 +161,15 @@ const char *get_sound_filename(SoundType type) {
 #include <conio.h>
 #include <mmsystem.h>
 #include <direct.h>
+#include <malloc.h>
 #pragma comment(lib, "winmm.lib")
 
 HANDLE g_hStdout;
 HANDLE g_hStdin;
+HANDLE g_wake_event;                // Set by platform_wake
 DWORD g_orig_stdout_mode;
 DWORD g_orig_stdin_mode;
+UINT g_orig_output_cp;
 CONSOLE_CURSOR_INFO g_orig_cursor_info;
 
 void platform_init() {
@@ -53,16 +185,24 @@ void platform_init() {
     DWORD stdout_mode = g_orig_stdout_mode | ENABLE_VIRTUAL_TERMINAL_PROCESSING;
     SetConsoleMode(g_hStdout, stdout_mode);
 
+    // Box-drawing walls are written as UTF-8
+    g_orig_output_cp = GetConsoleOutputCP();
+    SetConsoleOutputCP(CP_UTF8);
+
     // Disable line buffering
     DWORD stdin_mode = g_orig_stdin_mode & ~(ENABLE_LINE_INPUT | ENABLE_ECHO_INPUT);
     SetConsoleMode(g_hStdin, stdin_mode);
 
+    query_terminal_size(&g_term_rows, &g_term_cols);
+    g_wake_event = CreateEvent(NULL, FALSE, FALSE, NULL);
+
     atexit(platform_cleanup);
 }
 
 void platform_cleanup() {
     SetConsoleMode(g_hStdout, g_orig_stdout_mode);
     SetConsoleMode(g_hStdin, g_orig_stdin_mode);
+    SetConsoleOutputCP(g_orig_output_cp);
     SetConsoleCursorInfo(g_hStdout, &g_orig_cursor_info);
 }
 
@@ -110,7 +250,23 @@ long platform_time_ms() {
     return (long)((counter.QuadPart * 1000) / freq.QuadPart);
 }
 
-void platform_get_terminal_size(int *rows, int *cols) {
+long long platform_time_us() {
+    LARGE_INTEGER freq, counter;
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&counter);
+    return (long long)(counter.QuadPart / freq.QuadPart) * 1000000LL +
+           (long long)(counter.QuadPart % freq.QuadPart) * 1000000LL / freq.QuadPart;
+}
+
+long long platform_time_ns() {
+    LARGE_INTEGER freq, counter;
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&counter);
+    return (long long)(counter.QuadPart / freq.QuadPart) * 1000000000LL +
+           (long long)(counter.QuadPart % freq.QuadPart) * 1000000000LL / freq.QuadPart;
+}
+
+void query_terminal_size(int *rows, int *cols) {
     CONSOLE_SCREEN_BUFFER_INFO csbi;
     if (GetConsoleScreenBufferInfo(g_hStdout, &csbi)) {
         *cols = csbi.srWindow.Right - csbi.srWindow.Left + 1;
@@ -121,9 +277,50 @@ void platform_get_terminal_size(int *rows, int *cols) {
     }
 }
 
-void platform_write(const char *buf, int len) {
+// There is no resize signal on Windows, so look at the console size
+// a few times a second instead of on every frame
+bool platform_poll_resize() {
+    static long last_check = 0;
+    long now = platform_time_ms();
+    if (now - last_check < 250) {
+        return false;
+    }
+    last_check = now;
+
+    int rows, cols;
+    query_terminal_size(&rows, &cols);
+    if (rows == g_term_rows && cols == g_term_cols) {
+        return false;
+    }
+    g_term_rows = rows;
+    g_term_cols = cols;
+    return true;
+}
+
+bool platform_wait_input(int timeout_ms) {
+    HANDLE handles[2] = {g_hStdin, g_wake_event};
+    int count = g_wake_event != NULL ? 2 : 1;
+    DWORD result = WaitForMultipleObjects((DWORD)count, handles, FALSE, (DWORD)timeout_ms);
+    return result < WAIT_OBJECT_0 + (DWORD)count;
+}
+
+void platform_wake() {
+    if (g_wake_event != NULL) {
+        SetEvent(g_wake_event);
+    }
+}
+
+// The console has no non-blocking mode, so this always writes everything
+int os_write_some(const char *buf, int len) {
     DWORD written;
-    WriteConsoleA(g_hStdout, buf, (DWORD)len, &written, NULL);
+    if (WriteConsoleA(g_hStdout, buf, (DWORD)len, &written, NULL) == 0) {
+        return -1;
+    }
+    return (int)written;
+}
+
+void platform_output_drain() {
+    platform_output_flush();
 }
 
 void platform_clear_screen() {
@@ -140,31 +337,160 @@ void platform_play_sound(SoundType type) {
     PlaySoundA(path, NULL, SND_FILENAME | SND_ASYNC | SND_NODEFAULT);
 }
 
-void platform_get_highscore_path(char *buf, int size) {
-    snprintf(buf, size, "data");
+bool platform_get_highscore_path(char *buf, int size) {
+    const char *custom = getenv("PACMAN_LEADERBOARD");
+    const char *home = getenv("LOCALAPPDATA");
+    if (custom != NULL) {
+        snprintf(buf, size, "%s", custom);
+    } else if (home != NULL) {
+        snprintf(buf, size, "%s\\pacman_leaderboard", home);
+    } else {
+        return false;
+    }
+    return true;
 }
 
-bool platform_save_highscore(unsigned int score) {
-    char path[512];
-    platform_get_highscore_path(path, sizeof(path));
-    FILE *f = fopen(path, "w");
-    if (f == NULL) return false;
-    fprintf(f, "%u\n", score);
-    fclose(f);
-    return true;
+void *platform_map_shared(const char *path, size_t size) {
+    HANDLE file = CreateFileA(path, GENERIC_READ | GENERIC_WRITE,
+                              FILE_SHARE_READ | FILE_SHARE_WRITE, NULL,
+                              OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) return NULL;
+
+    // Grows a new (or short) file to `size` with zeros
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READWRITE, 0, (DWORD)size, NULL);
+    CloseHandle(file);
+    if (mapping == NULL) return NULL;
+
+    void *ptr = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, size);
+    CloseHandle(mapping);
+    return ptr;
 }
 
-unsigned int platform_load_highscore() {
-    char path[512];
-    platform_get_highscore_path(path, sizeof(path));
-    FILE *f = fopen(path, "r");
-    if (f == NULL) return 0;
-    unsigned int score = 0;
-    if (fscanf(f, "%u", &score) != 1) {
-        score = 0;
+void platform_flush_shared(void *ptr, size_t size) {
+    FlushViewOfFile(ptr, size);
+}
+
+void platform_unmap_shared(void *ptr, size_t size) {
+    (void)size;
+    UnmapViewOfFile(ptr);
+}
+
+void *platform_shm_create(const char *name, size_t size) {
+    char path[256];
+    snprintf(path, sizeof(path), "Local\\%s", name);
+
+    HANDLE mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE,
+                                        (DWORD)((unsigned long long)size >> 32), (DWORD)size, path);
+    if (mapping == NULL) return NULL;
+    if (GetLastError() == ERROR_ALREADY_EXISTS) {
+        CloseHandle(mapping);
+        return NULL;
+    }
+
+    // The view keeps the mapping (and its name) alive
+    void *ptr = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, size);
+    CloseHandle(mapping);
+    return ptr;
+}
+
+const void *platform_shm_open(const char *name, size_t *size) {
+    char path[256];
+    MEMORY_BASIC_INFORMATION info;
+    snprintf(path, sizeof(path), "Local\\%s", name);
+
+    HANDLE mapping = OpenFileMappingA(FILE_MAP_READ, FALSE, path);
+    if (mapping == NULL) return NULL;
+    const void *ptr = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);
+    if (ptr == NULL) return NULL;
+
+    // Rounded up to whole pages, which the reader has to allow for
+    VirtualQuery(ptr, &info, sizeof(info));
+    *size = info.RegionSize;
+    return ptr;
+}
+
+void platform_shm_close(const void *ptr, size_t size, const char *name) {
+    (void)size;
+    (void)name;
+    UnmapViewOfFile(ptr);
+}
+
+void *platform_aligned_alloc(size_t alignment, size_t size) {
+    return _aligned_malloc(size, alignment);
+}
+
+void platform_aligned_free(void *ptr) {
+    _aligned_free(ptr);
+}
+
+struct PlatformThread {
+    HANDLE handle;
+    void (*fn)(void *);
+    void *arg;
+};
+
+DWORD WINAPI thread_main(LPVOID param) {
+    struct PlatformThread *thread = param;
+    thread->fn(thread->arg);
+    return 0;
+}
+
+struct PlatformThread *platform_thread_start(void (*fn)(void *), void *arg) {
+    struct PlatformThread *thread = malloc(sizeof(*thread));
+    if (thread == NULL) return NULL;
+    thread->fn = fn;
+    thread->arg = arg;
+    thread->handle = CreateThread(NULL, 0, thread_main, thread, 0, NULL);
+    if (thread->handle == NULL) {
+        free(thread);
+        return NULL;
     }
-    fclose(f);
-    return score;
+    return thread;
+}
+
+void platform_thread_join(struct PlatformThread *thread) {
+    WaitForSingleObject(thread->handle, INFINITE);
+    CloseHandle(thread->handle);
+    free(thread);
+}
+
+void platform_sleep_ms(int ms) {
+    Sleep((DWORD)ms);
+}
+
+int platform_cpu_count() {
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (int)info.dwNumberOfProcessors;
+}
+
+int platform_local_accept(const char *path) {
+    (void)path;
+    return -1;
+}
+
+int platform_local_connect(const char *path) {
+    (void)path;
+    return -1;
+}
+
+int platform_socket_send(int sock, const void *buf, int len) {
+    (void)sock;
+    (void)buf;
+    (void)len;
+    return -1;
+}
+
+int platform_socket_recv(int sock, void *buf, int len) {
+    (void)sock;
+    (void)buf;
+    (void)len;
+    return -1;
+}
+
+void platform_socket_close(int sock) {
+    (void)sock;
 }
 
 /* ============================================================
@@ -177,14 +503,111 @@ unsigned int platform_load_highscore() {
 #include <termios.h>
 #include <unistd.h>
 #include <signal.h>
+#include <pthread.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <pwd.h>
 
 struct termios g_orig_termios;
+int g_orig_stdout_flags = -1;
+int g_out_fd = STDOUT_FILENO;       // Where frames go (see platform_init)
 volatile sig_atomic_t g_signal_received = 0;
+int g_resize_pipe[2] = {-1, -1};
+int g_wake_pipe[2] = {-1, -1};      // Written by platform_wake
+
+// Stop the sound thread, if it was started (see platform_play_sound)
+void sound_stop();
 
 void signal_handler(int sig) {
     g_signal_received = 1;
 }
 
+// SIGWINCH: poke the self-pipe so the main loop wakes up and re-reads
+// the terminal size (only write() is safe to call in here)
+void resize_handler(int sig) {
+    int saved_errno = errno;
+    (void)sig;
+    if (write(g_resize_pipe[1], "x", 1) < 0) {
+        // Pipe full: a resize is already waiting to be noticed
+    }
+    errno = saved_errno;
+}
+
+int os_write_some(const char *buf, int len) {
+    while (true) {
+        ssize_t n = write(g_out_fd, buf, (size_t)len);
+        if (n >= 0) {
+            return (int)n;
+        }
+        if (errno == EINTR) {
+            continue;
+        }
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            return 0;
+        }
+        return -1;
+    }
+}
+
+// Wait until the terminal can take more output (gives up after `ms`)
+bool wait_writable(int ms) {
+    fd_set fds;
+    FD_ZERO(&fds);
+    FD_SET(g_out_fd, &fds);
+
+    struct timeval tv;
+    tv.tv_sec = ms / 1000;
+    tv.tv_usec = (ms % 1000) * 1000;
+
+    return select(g_out_fd + 1, NULL, &fds, NULL, &tv) > 0;
+}
+
+void platform_output_drain() {
+    // Don't hang forever on a terminal that stopped reading
+    int tries = 0;
+    while (platform_output_flush() == false && tries < 20) {
+        wait_writable(100);
+        tries = tries + 1;
+    }
+}
+
+// Write a control sequence straight away, behind any queued frames
+void write_now(const char *seq) {
+    platform_output_drain();
+    int len = (int)strlen(seq);
+    int sent = 0;
+    int tries = 0;
+    while (sent < len && tries < 20) {
+        int n = os_write_some(seq + sent, len - sent);
+        if (n < 0) return;
+        if (n > 0 && g_output_tap != NULL) {
+            g_output_tap(seq + sent, n);
+        }
+        if (n == 0) {
+            wait_writable(100);
+            tries = tries + 1;
+        }
+        sent = sent + n;
+    }
+}
+
+// A pipe that never blocks either end and isn't inherited by players
+// started for sounds
+bool open_self_pipe(int fds[2]) {
+    if (pipe(fds) != 0) {
+        return false;
+    }
+    fcntl(fds[0], F_SETFL, O_NONBLOCK);
+    fcntl(fds[1], F_SETFL, O_NONBLOCK);
+    fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+    fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+    return true;
+}
+
 void platform_init() {
     if (isatty(STDIN_FILENO) == 0) {
         fprintf(stderr, "Error: stdin is not a terminal\n");
@@ -212,20 +635,74 @@ void platform_init() {
         perror("tcsetattr");
         exit(1);
     }
+
+    // Never let a slow terminal block the game. Non-blocking is a flag
+    // on the open file, which stdout shares with the shell and anything
+    // else started from it, so the game opens the terminal again for
+    // itself. Only if that fails does stdout itself go non-blocking
+    // until platform_cleanup.
+    const char *tty = isatty(STDOUT_FILENO) ? ttyname(STDOUT_FILENO) : NULL;
+    if (tty != NULL) {
+        g_out_fd = open(tty, O_WRONLY | O_NONBLOCK | O_CLOEXEC);
+    }
+    if (g_out_fd == -1 || tty == NULL) {
+        g_out_fd = STDOUT_FILENO;
+        g_orig_stdout_flags = fcntl(STDOUT_FILENO, F_GETFL);
+        if (g_orig_stdout_flags != -1) {
+            fcntl(STDOUT_FILENO, F_SETFL, g_orig_stdout_flags | O_NONBLOCK);
+        }
+    }
+
+    // Other threads wake the main loop through a pipe of their own
+    if (open_self_pipe(g_wake_pipe) == false) {
+        g_wake_pipe[0] = -1;
+        g_wake_pipe[1] = -1;
+    }
+
+    // Watch for terminal resizes
+    query_terminal_size(&g_term_rows, &g_term_cols);
+    if (open_self_pipe(g_resize_pipe)) {
+        struct sigaction sa;
+        memset(&sa, 0, sizeof(sa));
+        sa.sa_handler = resize_handler;
+        sa.sa_flags = SA_RESTART;
+        sigemptyset(&sa.sa_mask);
+        sigaction(SIGWINCH, &sa, NULL);
+    } else {
+        g_resize_pipe[0] = -1;
+        g_resize_pipe[1] = -1;
+    }
 }
 
 void platform_cleanup() {
+    sound_stop();
+    platform_output_drain();
+    if (g_out_fd != STDOUT_FILENO) {
+        close(g_out_fd);
+        g_out_fd = STDOUT_FILENO;
+    }
+    if (g_orig_stdout_flags != -1) {
+        fcntl(STDOUT_FILENO, F_SETFL, g_orig_stdout_flags);
+    }
     tcsetattr(STDIN_FILENO, TCSAFLUSH, &g_orig_termios);
 }
 
 void platform_enter_fullscreen() {
-    const char *seq = "\033[?1049h\033[?25l";
-    write(STDOUT_FILENO, seq, strlen(seq));
+    write_now("\033[?1049h\033[?25l");
+
+    // Ask the terminal whether it does synchronized updates. The answer
+    // comes back as input and is picked up by platform_getch. Setting
+    // PACMAN_SYNC_OUTPUT=0 or 1 skips the question.
+    const char *sync = getenv("PACMAN_SYNC_OUTPUT");
+    if (sync != NULL) {
+        g_sync_output = strcmp(sync, "0") != 0;
+    } else {
+        write_now("\033[?2026$p");
+    }
 }
 
 void platform_exit_fullscreen() {
-    const char *seq = "\033[?25h\033[?1049l";
-    write(STDOUT_FILENO, seq, strlen(seq));
+    write_now("\033[?25h\033[?1049l");
 }
 
 bool platform_kbhit() {
@@ -244,6 +721,26 @@ bool platform_kbhit() {
     return select(STDIN_FILENO + 1, &fds, NULL, NULL, &tv) > 0;
 }
 
+// Read the rest of a "\033[?2026;<state>$y" answer to our question in
+// platform_enter_fullscreen. State 1-3 means synchronized updates work.
+void read_mode_report() {
+    char report[32];
+    int len = 0;
+    unsigned char c;
+    while (len < (int)sizeof(report) - 1 && read(STDIN_FILENO, &c, 1) == 1) {
+        report[len] = (char)c;
+        len = len + 1;
+        if (c == 'y') break;
+    }
+    report[len] = '\0';
+
+    int mode = 0;
+    int state = 0;
+    if (sscanf(report, "%d;%d$y", &mode, &state) == 2 && mode == 2026) {
+        g_sync_output = state >= 1 && state <= 3;
+    }
+}
+
 int platform_getch() {
     if (g_signal_received) {
         return 'q';
@@ -260,6 +757,10 @@ int platform_getch() {
                     if (seq[1] == 'B') return 's';  // Down
                     if (seq[1] == 'C') return 'd';  // Right
                     if (seq[1] == 'D') return 'a';  // Left
+                    if (seq[1] == '?') {
+                        read_mode_report();
+                        return -1;
+                    }
                 }
             }
             return '\033';
@@ -275,7 +776,19 @@ long platform_time_ms() {
     return ts.tv_sec * 1000L + ts.tv_nsec / 1000000L;
 }
 
-void platform_get_terminal_size(int *rows, int *cols) {
+long long platform_time_us() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000LL + ts.tv_nsec / 1000L;
+}
+
+long long platform_time_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+void query_terminal_size(int *rows, int *cols) {
     struct winsize ws;
     if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == 0 && ws.ws_row > 0) {
         *rows = ws.ws_row;
@@ -286,16 +799,78 @@ void platform_get_terminal_size(int *rows, int *cols) {
     }
 }
 
-void platform_write(const char *buf, int len) {
-    write(STDOUT_FILENO, buf, (size_t)len);
+bool platform_poll_resize() {
+    char drain[64];
+    bool resized = false;
+    while (g_resize_pipe[0] != -1 && read(g_resize_pipe[0], drain, sizeof(drain)) > 0) {
+        resized = true;
+    }
+    if (resized) {
+        query_terminal_size(&g_term_rows, &g_term_cols);
+    }
+    return resized;
+}
+
+// Also wakes up when queued output can go out, so a frame held back
+// for a busy terminal is sent (and the next one drawn) without delay
+bool platform_wait_input(int timeout_ms) {
+    fd_set fds, out_fds;
+    FD_ZERO(&fds);
+    FD_ZERO(&out_fds);
+    FD_SET(STDIN_FILENO, &fds);
+    int max_fd = STDIN_FILENO;
+    if (g_resize_pipe[0] != -1) {
+        FD_SET(g_resize_pipe[0], &fds);
+        if (g_resize_pipe[0] > max_fd) max_fd = g_resize_pipe[0];
+    }
+    if (g_wake_pipe[0] != -1) {
+        FD_SET(g_wake_pipe[0], &fds);
+        if (g_wake_pipe[0] > max_fd) max_fd = g_wake_pipe[0];
+    }
+    struct PlatformOutputStats stats;
+    platform_output_stats(&stats);
+    if (stats.bytes_queued > 0) {
+        FD_SET(g_out_fd, &out_fds);
+        if (g_out_fd > max_fd) max_fd = g_out_fd;
+    }
+
+    struct timeval tv;
+    tv.tv_sec = timeout_ms / 1000;
+    tv.tv_usec = (timeout_ms % 1000) * 1000;
+
+    if (select(max_fd + 1, &fds, &out_fds, NULL, &tv) <= 0) {
+        return false;
+    }
+    if (g_wake_pipe[0] != -1 && FD_ISSET(g_wake_pipe[0], &fds)) {
+        char drain[64];
+        while (read(g_wake_pipe[0], drain, sizeof(drain)) > 0) {
+        }
+    }
+    return true;
+}
+
+void platform_wake() {
+    if (g_wake_pipe[1] != -1 && write(g_wake_pipe[1], "x", 1) < 0) {
+        // Pipe full: the main loop is already due to wake up
+    }
 }
 
 void platform_clear_screen() {
-    const char *clear = "\033[2J\033[H";
-    write(STDOUT_FILENO, clear, strlen(clear));
+    write_now("\033[2J\033[H");
 }
 
-void platform_play_sound(SoundType type) {
+// Starting a player goes through a shell, which takes milliseconds, so
+// sounds are played from a background thread started on first use. The
+// caller only sets a bit and signals; the same sound asked for again
+// before the thread gets to it is played once. platform_cleanup stops
+// the thread and waits for it.
+pthread_mutex_t g_sound_lock = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t g_sound_cond = PTHREAD_COND_INITIALIZER;
+uint64_t g_sound_pending = 0;               // Bit per SoundType
+bool g_sound_quit = false;
+struct PlatformThread *g_sound_thread = NULL;
+
+void play_sound_now(SoundType type) {
     const char *filename = get_sound_filename(type);
     if (filename == NULL) return;
     
@@ -315,31 +890,306 @@ void platform_play_sound(SoundType type) {
     system(cmd);
 }
 
-void platform_get_highscore_path(char *buf, int size) {
-    snprintf(buf, (size_t)size, "data");
+void sound_thread(void *arg) {
+    uint64_t pending;
+    int type;
+    (void)arg;
+
+    pthread_mutex_lock(&g_sound_lock);
+    while (g_sound_quit == false) {
+        if (g_sound_pending == 0) {
+            pthread_cond_wait(&g_sound_cond, &g_sound_lock);
+            continue;
+        }
+        pending = g_sound_pending;
+        g_sound_pending = 0;
+        pthread_mutex_unlock(&g_sound_lock);
+
+        for (type = 0; type < 64; type = type + 1) {
+            if (pending & ((uint64_t)1 << type)) {
+                play_sound_now(type);
+            }
+        }
+        pthread_mutex_lock(&g_sound_lock);
+    }
+    pthread_mutex_unlock(&g_sound_lock);
 }
 
-bool platform_save_highscore(unsigned int score) {
-    char path[512];
-    platform_get_highscore_path(path, sizeof(path));
-    FILE *f = fopen(path, "w");
-    if (f == NULL) return false;
-    fprintf(f, "%u\n", score);
-    fclose(f);
+void platform_play_sound(SoundType type) {
+    if (type < 0 || type >= 64) return;
+
+    pthread_mutex_lock(&g_sound_lock);
+    if (g_sound_quit == false) {
+        g_sound_pending = g_sound_pending | ((uint64_t)1 << type);
+        if (g_sound_thread == NULL) {
+            g_sound_thread = platform_thread_start(sound_thread, NULL);
+        }
+        pthread_cond_signal(&g_sound_cond);
+    }
+    pthread_mutex_unlock(&g_sound_lock);
+}
+
+void sound_stop() {
+    pthread_mutex_lock(&g_sound_lock);
+    struct PlatformThread *thread = g_sound_thread;
+    g_sound_thread = NULL;
+    g_sound_quit = true;
+    pthread_cond_signal(&g_sound_cond);
+    pthread_mutex_unlock(&g_sound_lock);
+
+    if (thread != NULL) {
+        platform_thread_join(thread);
+    }
+}
+
+bool platform_get_highscore_path(char *buf, int size) {
+    const char *custom = getenv("PACMAN_LEADERBOARD");
+    const char *home = getenv("HOME");
+
+    // Without $HOME, ask the password database where home is
+    struct passwd *pw = home == NULL ? getpwuid(getuid()) : NULL;
+    if (pw != NULL && pw->pw_dir != NULL && pw->pw_dir[0] == '/') {
+        home = pw->pw_dir;
+    }
+
+    if (custom != NULL) {
+        snprintf(buf, (size_t)size, "%s", custom);
+    } else if (home != NULL) {
+        snprintf(buf, (size_t)size, "%s/.pacman_leaderboard", home);
+    } else {
+        return false;
+    }
     return true;
 }
 
-unsigned int platform_load_highscore() {
-    char path[512];
-    platform_get_highscore_path(path, sizeof(path));
-    FILE *f = fopen(path, "r");
-    if (f == NULL) return 0;
-    unsigned int score = 0;
-    if (fscanf(f, "%u", &score) != 1) {
-        score = 0;
-    }
-    fclose(f);
-    return score;
+void *platform_map_shared(const char *path, size_t size) {
+    int fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd == -1) return NULL;
+
+    // Grow a new (or short) file to `size`; the new bytes read as zero
+    struct stat st;
+    if (fstat(fd, &st) == -1 || ((size_t)st.st_size < size && ftruncate(fd, (off_t)size) == -1)) {
+        close(fd);
+        return NULL;
+    }
+
+    void *ptr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (ptr == MAP_FAILED) return NULL;
+    return ptr;
+}
+
+void platform_flush_shared(void *ptr, size_t size) {
+    msync(ptr, size, MS_SYNC);
+}
+
+void platform_unmap_shared(void *ptr, size_t size) {
+    munmap(ptr, size);
+}
+
+void *platform_shm_create(const char *name, size_t size) {
+    char path[256];
+    snprintf(path, sizeof(path), "/%s", name);
+
+    // Always a new object: anyone still reading an old one keeps theirs
+    shm_unlink(path);
+    int fd = shm_open(path, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+    if (fd == -1) return NULL;
+    if (ftruncate(fd, (off_t)size) == -1) {
+        close(fd);
+        shm_unlink(path);
+        return NULL;
+    }
+
+    void *ptr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (ptr == MAP_FAILED) {
+        shm_unlink(path);
+        return NULL;
+    }
+    return ptr;
+}
+
+const void *platform_shm_open(const char *name, size_t *size) {
+    char path[256];
+    struct stat st;
+    snprintf(path, sizeof(path), "/%s", name);
+
+    int fd = shm_open(path, O_RDONLY | O_CLOEXEC, 0);
+    if (fd == -1) return NULL;
+
+    // Empty until the game has set it up
+    if (fstat(fd, &st) == -1 || st.st_size == 0) {
+        close(fd);
+        return NULL;
+    }
+
+    void *ptr = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (ptr == MAP_FAILED) return NULL;
+    *size = (size_t)st.st_size;
+    return ptr;
+}
+
+void platform_shm_close(const void *ptr, size_t size, const char *name) {
+    char path[256];
+    munmap((void *)ptr, size);
+    if (name != NULL) {
+        snprintf(path, sizeof(path), "/%s", name);
+        shm_unlink(path);
+    }
+}
+
+void *platform_aligned_alloc(size_t alignment, size_t size) {
+    void *ptr = NULL;
+    if (posix_memalign(&ptr, alignment, size) != 0) {
+        return NULL;
+    }
+    return ptr;
+}
+
+void platform_aligned_free(void *ptr) {
+    free(ptr);
+}
+
+struct PlatformThread {
+    pthread_t handle;
+    void (*fn)(void *);
+    void *arg;
+};
+
+void *thread_main(void *param) {
+    struct PlatformThread *thread = param;
+    thread->fn(thread->arg);
+    return NULL;
+}
+
+struct PlatformThread *platform_thread_start(void (*fn)(void *), void *arg) {
+    struct PlatformThread *thread = malloc(sizeof(*thread));
+    if (thread == NULL) return NULL;
+    thread->fn = fn;
+    thread->arg = arg;
+    if (pthread_create(&thread->handle, NULL, thread_main, thread) != 0) {
+        free(thread);
+        return NULL;
+    }
+    return thread;
+}
+
+void platform_thread_join(struct PlatformThread *thread) {
+    pthread_join(thread->handle, NULL);
+    free(thread);
+}
+
+void platform_sleep_ms(int ms) {
+    struct timespec ts;
+    ts.tv_sec = ms / 1000;
+    ts.tv_nsec = (long)(ms % 1000) * 1000000L;
+    nanosleep(&ts, NULL);
+}
+
+int platform_cpu_count() {
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (int)count : 1;
+}
+
+// Fill in a Unix socket address; false if the path is too long
+bool local_address(const char *path, struct sockaddr_un *addr) {
+    memset(addr, 0, sizeof(*addr));
+    addr->sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr->sun_path)) {
+        return false;
+    }
+    strcpy(addr->sun_path, path);
+    return true;
+}
+
+// macOS has no MSG_NOSIGNAL, so turn SIGPIPE off on the socket itself
+void local_no_sigpipe(int sock) {
+#ifdef SO_NOSIGPIPE
+    int on = 1;
+    setsockopt(sock, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#else
+    (void)sock;
+#endif
+}
+
+int platform_local_accept(const char *path) {
+    struct sockaddr_un addr;
+    if (local_address(path, &addr) == false) {
+        return -1;
+    }
+
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener < 0) {
+        return -1;
+    }
+    unlink(path);
+    if (bind(listener, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(listener, 1) != 0) {
+        close(listener);
+        return -1;
+    }
+
+    int sock;
+    do {
+        sock = accept(listener, NULL, NULL);
+    } while (sock < 0 && errno == EINTR);
+
+    // Only one game joins, so nobody else needs to find us
+    close(listener);
+    unlink(path);
+    if (sock >= 0) {
+        local_no_sigpipe(sock);
+    }
+    return sock;
+}
+
+int platform_local_connect(const char *path) {
+    struct sockaddr_un addr;
+    if (local_address(path, &addr) == false) {
+        return -1;
+    }
+
+    int sock = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (sock < 0) {
+        return -1;
+    }
+    if (connect(sock, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        close(sock);
+        return -1;
+    }
+    local_no_sigpipe(sock);
+    return sock;
+}
+
+int platform_socket_send(int sock, const void *buf, int len) {
+    // A closed connection should be an error, not SIGPIPE
+#ifdef MSG_NOSIGNAL
+    ssize_t n = send(sock, buf, (size_t)len, MSG_DONTWAIT | MSG_NOSIGNAL);
+#else
+    ssize_t n = send(sock, buf, (size_t)len, MSG_DONTWAIT);
+#endif
+    if (n < 0) {
+        return (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) ? 0 : -1;
+    }
+    return (int)n;
+}
+
+int platform_socket_recv(int sock, void *buf, int len) {
+    ssize_t n = recv(sock, buf, (size_t)len, MSG_DONTWAIT);
+    if (n == 0) {
+        return -1;  // Closed by the other side
+    }
+    if (n < 0) {
+        return (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) ? 0 : -1;
+    }
+    return (int)n;
+}
+
+void platform_socket_close(int sock) {
+    if (sock >= 0) {
+        close(sock);
+    }
 }
 
 #endif
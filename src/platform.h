@@ -5,7 +5,10 @@
  * the terminal on Windows and Mac/Linux is very different.
  */
 
+#pragma once
+
 #include <stdbool.h>
+#include <stddef.h>
 
 // Setup terminal for the game
 void platform_init();
@@ -28,12 +31,48 @@ int platform_getch();
 // Get current time in milliseconds
 long platform_time_ms();
 
-// Get terminal size
+// Get current time in microseconds (for measuring things)
+long long platform_time_us();
+
+// Get current time in nanoseconds (for timing single frames)
+long long platform_time_ns();
+
+// Get terminal size (cached; no system call)
 void platform_get_terminal_size(int *rows, int *cols);
 
-// Write text to screen
+// Returns true if the terminal was resized since the last call
+bool platform_poll_resize();
+
+// Wait until a key is pressed, the terminal is resized, platform_wake
+// is called or `timeout_ms` passes. Returns true if something happened.
+bool platform_wait_input(int timeout_ms);
+
+// Wake up platform_wait_input early. Safe to call from any thread.
+void platform_wake();
+
+// Write a frame to screen. Never blocks: if the terminal is still busy
+// the frame is queued, and only the newest queued frame is kept.
 void platform_write(const char *buf, int len);
 
+// Keep writing queued output; returns true once everything is out
+bool platform_output_flush();
+
+// Block (briefly) until queued output is written, e.g. before exiting
+void platform_output_drain();
+
+// Output counters
+struct PlatformOutputStats {
+    unsigned long frames_written;
+    unsigned long frames_dropped;   // Replaced while waiting for the terminal
+    unsigned long bytes_written;
+    int bytes_queued;               // Waiting to be written right now
+};
+
+void platform_output_stats(struct PlatformOutputStats *stats);
+
+// Get a copy of every byte as it reaches the terminal (NULL to stop)
+void platform_set_output_tap(void (*tap)(const char *buf, int len));
+
 // Clear the screen
 void platform_clear_screen();
 
@@ -49,11 +88,71 @@ typedef int SoundType;
 // Play a sound
 void platform_play_sound(SoundType type);
 
-// Get path to high score file
-void platform_get_highscore_path(char *buf, int size);
+// Get path to the leaderboard file ($PACMAN_LEADERBOARD overrides it).
+// Returns false if there is no home directory to keep it in.
+bool platform_get_highscore_path(char *buf, int size);
+
+// Map a file into memory, shared with every process that maps it. The
+// file is created and zero-filled up to `size` if needed. NULL on failure.
+void *platform_map_shared(const char *path, size_t size);
+
+// Write a shared mapping back to disk (slow; keep off the game thread)
+void platform_flush_shared(void *ptr, size_t size);
+
+// Undo platform_map_shared
+void platform_unmap_shared(void *ptr, size_t size);
+
+// Named shared memory with no file behind it (shm_open on Mac and
+// Linux, a named file mapping on Windows), for other processes to read.
+// Creates it zero-filled; on Mac and Linux an old one with the same name
+// is replaced, on Windows it fails while another game still has it.
+void *platform_shm_create(const char *name, size_t size);
+
+// Map someone else's named shared memory read-only and set `size`.
+// NULL if there is none.
+const void *platform_shm_open(const char *name, size_t *size);
+
+// Undo platform_shm_create (pass the name, so it goes away too) or
+// platform_shm_open (pass NULL)
+void platform_shm_close(const void *ptr, size_t size, const char *name);
+
+// Allocate memory that starts on an `alignment` byte boundary
+void *platform_aligned_alloc(size_t alignment, size_t size);
+
+// Free memory from platform_aligned_alloc
+void platform_aligned_free(void *ptr);
+
+// Threads
+struct PlatformThread;
+
+// Start `fn(arg)` on a new thread; returns NULL if that failed
+struct PlatformThread *platform_thread_start(void (*fn)(void *), void *arg);
+
+// Wait for a thread to finish and free its handle
+void platform_thread_join(struct PlatformThread *thread);
+
+// Sleep for a number of milliseconds
+void platform_sleep_ms(int ms);
+
+// Number of CPU cores we can run threads on
+int platform_cpu_count();
+
+// Local connections between two games on the same machine (Unix domain
+// sockets). Handles are -1 on failure. Not supported on Windows yet, so
+// there they always fail.
+
+// Listen on `path` and wait for one game to connect. Returns the connection.
+int platform_local_accept(const char *path);
+
+// Connect to a game waiting on `path`
+int platform_local_connect(const char *path);
+
+// Send without blocking. Returns the bytes sent (0 if the connection is
+// busy) or -1 if it is gone.
+int platform_socket_send(int sock, const void *buf, int len);
 
-// Save high score
-bool platform_save_highscore(unsigned int score);
+// Receive without blocking. Returns the bytes read (0 if nothing has
+// arrived) or -1 if the connection is gone.
+int platform_socket_recv(int sock, void *buf, int len);
 
-// Load high score
-unsigned int platform_load_highscore();
+void platform_socket_close(int sock);
@@ -0,0 +1,289 @@
+#include "recorder.h"
+#include "atomics.h"
+#include "platform.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef PACMAN_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+// Formatted output is written (and compressed) in chunks of about this size
+#define RECORDER_CHUNK_SIZE (64 * 1024)
+
+// Each captured chunk goes into the ring as: timestamp (8 bytes),
+// length (4 bytes), then the bytes themselves
+#define RECORD_HEADER_SIZE 12
+
+struct Recorder {
+    unsigned char *ring;
+    _Alignas(64) volatile uint64_t head;  // Read position (writer thread)
+    _Alignas(64) volatile uint64_t tail;  // Write position (game thread)
+    uint64_t bytes_dropped;               // Game thread only
+    uint64_t bytes_recorded;              // Writer thread only
+    uint64_t file_bytes;                  // Writer thread only
+    long long start_us;
+
+    FILE *file;
+    bool gzip;
+    char *chunk;                          // Formatted events waiting to be written
+    int chunk_len;
+    int chunk_cap;
+    unsigned char carry[4];               // Unfinished UTF-8 character from the last record
+    int carry_len;
+
+    struct PlatformThread *thread;
+    volatile int stop;
+};
+
+struct Recorder g_rec;
+bool g_recording = false;
+
+// Copy into / out of the ring, wrapping around the end
+void ring_put(uint64_t pos, const void *data, int len) {
+    int offset = (int)(pos % RECORDER_RING_SIZE);
+    int first = RECORDER_RING_SIZE - offset;
+    if (first > len) first = len;
+    memcpy(g_rec.ring + offset, data, (size_t)first);
+    memcpy(g_rec.ring, (const unsigned char *)data + first, (size_t)(len - first));
+}
+
+void ring_get(uint64_t pos, void *data, int len) {
+    int offset = (int)(pos % RECORDER_RING_SIZE);
+    int first = RECORDER_RING_SIZE - offset;
+    if (first > len) first = len;
+    memcpy(data, g_rec.ring + offset, (size_t)first);
+    memcpy((unsigned char *)data + first, g_rec.ring, (size_t)(len - first));
+}
+
+// Make room for `extra` more bytes of formatted output
+void chunk_reserve(int extra) {
+    if (g_rec.chunk_len + extra <= g_rec.chunk_cap) {
+        return;
+    }
+    int cap = g_rec.chunk_cap * 2;
+    while (cap < g_rec.chunk_len + extra) {
+        cap = cap * 2;
+    }
+    char *chunk = realloc(g_rec.chunk, (size_t)cap);
+    if (chunk == NULL) {
+        abort();
+    }
+    g_rec.chunk = chunk;
+    g_rec.chunk_cap = cap;
+}
+
+// Write the formatted chunk to disk (as its own gzip member if compressing)
+void chunk_write() {
+    if (g_rec.chunk_len == 0) {
+        return;
+    }
+#ifdef PACMAN_HAVE_ZLIB
+    if (g_rec.gzip) {
+        z_stream zs;
+        memset(&zs, 0, sizeof(zs));
+        if (deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) == Z_OK) {
+            uLong bound = deflateBound(&zs, (uLong)g_rec.chunk_len);
+            unsigned char *out = malloc(bound);
+            if (out != NULL) {
+                zs.next_in = (Bytef *)g_rec.chunk;
+                zs.avail_in = (uInt)g_rec.chunk_len;
+                zs.next_out = out;
+                zs.avail_out = (uInt)bound;
+                deflate(&zs, Z_FINISH);
+                fwrite(out, 1, zs.total_out, g_rec.file);
+                g_rec.file_bytes = g_rec.file_bytes + zs.total_out;
+                free(out);
+            }
+            deflateEnd(&zs);
+        }
+        g_rec.chunk_len = 0;
+        return;
+    }
+#endif
+    fwrite(g_rec.chunk, 1, (size_t)g_rec.chunk_len, g_rec.file);
+    g_rec.file_bytes = g_rec.file_bytes + (uint64_t)g_rec.chunk_len;
+    g_rec.chunk_len = 0;
+}
+
+// Add one asciicast output event: [seconds, "o", "text"]
+void write_event(long long time_us, const unsigned char *data, int len) {
+    unsigned char *bytes = malloc((size_t)(len + g_rec.carry_len));
+    int total = g_rec.carry_len + len;
+    int i;
+
+    if (bytes == NULL) {
+        return;
+    }
+    memcpy(bytes, g_rec.carry, (size_t)g_rec.carry_len);
+    memcpy(bytes + g_rec.carry_len, data, (size_t)len);
+
+    // JSON strings must be whole UTF-8, so hold back a character that was
+    // split between two writes until the rest of it shows up
+    int keep = total;
+    for (i = total - 1; i >= 0 && i >= total - 3; i--) {
+        unsigned char c = bytes[i];
+        if ((c & 0xc0) == 0x80) continue;
+        int need = 1;
+        if ((c & 0xe0) == 0xc0) need = 2;
+        else if ((c & 0xf0) == 0xe0) need = 3;
+        else if ((c & 0xf8) == 0xf0) need = 4;
+        if (i + need > total) keep = i;
+        break;
+    }
+    g_rec.carry_len = total - keep;
+    memcpy(g_rec.carry, bytes + keep, (size_t)g_rec.carry_len);
+
+    // Worst case every byte becomes \u00XX
+    chunk_reserve(keep * 6 + 64);
+    char *p = g_rec.chunk + g_rec.chunk_len;
+    p = p + sprintf(p, "[%.6f, \"o\", \"", (double)(time_us - g_rec.start_us) / 1e6);
+    for (i = 0; i < keep; i++) {
+        unsigned char c = bytes[i];
+        if (c == '"' || c == '\\') {
+            *p = '\\';
+            p = p + 1;
+            *p = (char)c;
+            p = p + 1;
+        } else if (c < 0x20 || c == 0x7f) {
+            p = p + sprintf(p, "\\u%04x", c);
+        } else {
+            *p = (char)c;
+            p = p + 1;
+        }
+    }
+    p = p + sprintf(p, "\"]\n");
+    g_rec.chunk_len = (int)(p - g_rec.chunk);
+    g_rec.bytes_recorded = g_rec.bytes_recorded + (uint64_t)keep;
+
+    free(bytes);
+}
+
+// Disk writer thread: turn captured output into events and write them out
+void recorder_thread(void *arg) {
+    unsigned char *data = NULL;
+    int data_cap = 0;
+    (void)arg;
+
+    while (true) {
+        int stopping = atom_load(&g_rec.stop);
+        uint64_t tail = atom_load64(&g_rec.tail);
+        uint64_t head = g_rec.head;
+
+        while (head != tail) {
+            long long time_us;
+            int len;
+            ring_get(head, &time_us, 8);
+            ring_get(head + 8, &len, 4);
+            if (len > data_cap) {
+                unsigned char *bigger = realloc(data, (size_t)len);
+                if (bigger == NULL) abort();
+                data = bigger;
+                data_cap = len;
+            }
+            ring_get(head + RECORD_HEADER_SIZE, data, len);
+            head = head + RECORD_HEADER_SIZE + (uint64_t)len;
+            atom_store64(&g_rec.head, head);
+
+            write_event(time_us, data, len);
+            if (g_rec.chunk_len >= RECORDER_CHUNK_SIZE) {
+                chunk_write();
+            }
+        }
+
+        if (stopping) {
+            break;
+        }
+        platform_sleep_ms(5);
+    }
+
+    chunk_write();
+    free(data);
+}
+
+// Terminal output tap: called with every byte that reaches the terminal
+void recorder_capture(const char *buf, int len) {
+    if (g_recording == false || len <= 0) {
+        return;
+    }
+
+    uint64_t tail = g_rec.tail;
+    uint64_t used = tail - atom_load64(&g_rec.head);
+    if (used + RECORD_HEADER_SIZE + (uint64_t)len > RECORDER_RING_SIZE) {
+        g_rec.bytes_dropped = g_rec.bytes_dropped + (uint64_t)len;
+        return;
+    }
+
+    long long now = platform_time_us();
+    ring_put(tail, &now, 8);
+    ring_put(tail + 8, &len, 4);
+    ring_put(tail + RECORD_HEADER_SIZE, buf, len);
+    atom_store64(&g_rec.tail, tail + RECORD_HEADER_SIZE + (uint64_t)len);
+}
+
+bool recorder_start(const char *path, int rows, int cols) {
+    size_t path_len = strlen(path);
+
+    memset(&g_rec, 0, sizeof(g_rec));
+    g_rec.gzip = path_len > 3 && strcmp(path + path_len - 3, ".gz") == 0;
+#ifndef PACMAN_HAVE_ZLIB
+    if (g_rec.gzip) {
+        fprintf(stderr, "Error: this build can't write .gz recordings (no zlib)\n");
+        return false;
+    }
+#endif
+
+    g_rec.ring = malloc(RECORDER_RING_SIZE);
+    g_rec.chunk_cap = RECORDER_CHUNK_SIZE * 2;
+    g_rec.chunk = malloc((size_t)g_rec.chunk_cap);
+    g_rec.file = fopen(path, "wb");
+    if (g_rec.ring == NULL || g_rec.chunk == NULL || g_rec.file == NULL) {
+        perror(path);
+        if (g_rec.file != NULL) fclose(g_rec.file);
+        free(g_rec.ring);
+        free(g_rec.chunk);
+        return false;
+    }
+
+    // Touch the whole ring now so the game thread never takes page faults
+    memset(g_rec.ring, 0, RECORDER_RING_SIZE);
+
+    g_rec.start_us = platform_time_us();
+    g_rec.chunk_len = sprintf(g_rec.chunk, "{\"version\": 2, \"width\": %d, \"height\": %d, \"timestamp\": %lld}\n",
+                              cols, rows, (long long)time(NULL));
+
+    g_rec.thread = platform_thread_start(recorder_thread, NULL);
+    if (g_rec.thread == NULL) {
+        fclose(g_rec.file);
+        free(g_rec.ring);
+        free(g_rec.chunk);
+        return false;
+    }
+
+    g_recording = true;
+    platform_set_output_tap(recorder_capture);
+    return true;
+}
+
+void recorder_stop(struct RecorderStats *stats) {
+    if (g_recording == false) {
+        return;
+    }
+    platform_set_output_tap(NULL);
+    g_recording = false;
+
+    atom_store(&g_rec.stop, 1);
+    platform_thread_join(g_rec.thread);
+    fclose(g_rec.file);
+
+    if (stats != NULL) {
+        stats->bytes_recorded = g_rec.bytes_recorded;
+        stats->bytes_dropped = g_rec.bytes_dropped;
+        stats->file_bytes = g_rec.file_bytes;
+    }
+    free(g_rec.ring);
+    free(g_rec.chunk);
+}
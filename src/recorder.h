@@ -0,0 +1,35 @@
+/*
+ * Session recorder.
+ *
+ * Saves everything the game writes to the terminal, with timestamps, as
+ * an asciicast v2 file that `asciinema play` (or the web player) can
+ * show. The game thread only copies bytes into a lock-free ring buffer;
+ * a background thread formats them and does all the disk writing. If the
+ * writer can't keep up, data is dropped and counted rather than waited on.
+ *
+ * Files ending in ".gz" are written as gzip, one compressed member per
+ * chunk, when the game was built with zlib.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Bytes the game thread can get ahead of the disk writer
+#define RECORDER_RING_SIZE (4 * 1024 * 1024)
+
+struct RecorderStats {
+    uint64_t bytes_recorded;  // Terminal output that made it into the file
+    uint64_t bytes_dropped;   // Terminal output lost because the writer fell behind
+    uint64_t file_bytes;      // Bytes written to disk
+};
+
+// Start recording to `path`; rows/cols are the terminal size for the header
+bool recorder_start(const char *path, int rows, int cols);
+
+// Copy a chunk of terminal output into the recording (game thread only)
+void recorder_capture(const char *buf, int len);
+
+// Finish writing and close the file
+void recorder_stop(struct RecorderStats *stats);
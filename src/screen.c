@@ -0,0 +1,377 @@
+#include "screen.h"
+#include "level.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// How each game piece looks with 16, 256 and 24-bit colour
+struct PieceColor {
+    int ansi;             // 30-37
+    bool bold;
+    int color256;
+    int red, green, blue;
+};
+
+const struct PieceColor PIECE_COLORS[STYLE_COUNT - STYLE_WALL] = {
+    {34, false, 20, 33, 33, 222},      // Wall
+    {37, false, 223, 255, 184, 151},   // Dot
+    {33, true, 226, 255, 255, 0},      // Pac-man
+    {31, true, 196, 255, 0, 0},        // Chaser
+    {35, true, 219, 255, 184, 255},    // Ambusher
+    {36, true, 51, 0, 255, 255},       // Flanker
+    {33, true, 215, 255, 184, 82},     // Random
+};
+
+// Box-drawing wall for each shape (WALL_UP | WALL_DOWN | WALL_LEFT | WALL_RIGHT)
+const char *const WALL_LINES[16] = {
+    "\xe2\x96\xa0",   // 0: on its own
+    "\xe2\x94\x82",   // up
+    "\xe2\x94\x82",   // down
+    "\xe2\x94\x82",   // up down
+    "\xe2\x94\x80",   // left
+    "\xe2\x95\xaf",   // up left
+    "\xe2\x95\xae",   // down left
+    "\xe2\x94\xa4",   // up down left
+    "\xe2\x94\x80",   // right
+    "\xe2\x95\xb0",   // up right
+    "\xe2\x95\xad",   // down right
+    "\xe2\x94\x9c",   // up down right
+    "\xe2\x94\x80",   // left right
+    "\xe2\x94\xb4",   // up left right
+    "\xe2\x94\xac",   // down left right
+    "\xe2\x94\xbc",   // all four
+};
+
+bool has_text(const char *value, const char *const *words) {
+    int i;
+    if (value == NULL) {
+        return false;
+    }
+    for (i = 0; words[i] != NULL; i++) {
+        if (strstr(value, words[i]) != NULL) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void screen_detect(struct ScreenCaps *caps) {
+    static const char *const TRUECOLOR[] = {"truecolor", "24bit", NULL};
+    static const char *const COLOR256[] = {"256color", NULL};
+    static const char *const UTF8[] = {"UTF-8", "utf-8", "UTF8", "utf8", NULL};
+    const char *term = getenv("TERM");
+    const char *locale = getenv("LC_ALL");
+
+    if (locale == NULL || locale[0] == '\0') locale = getenv("LC_CTYPE");
+    if (locale == NULL || locale[0] == '\0') locale = getenv("LANG");
+
+    caps->colors = SCREEN_COLORS_16;
+    if (has_text(getenv("COLORTERM"), TRUECOLOR)) {
+        caps->colors = SCREEN_COLORS_24BIT;
+    } else if (has_text(term, COLOR256)) {
+        caps->colors = SCREEN_COLORS_256;
+    }
+    caps->unicode = has_text(locale, UTF8);
+
+    // Only terminals known to have REP. One that ignores it would leave
+    // holes in the walls.
+    caps->repeat = getenv("XTERM_VERSION") != NULL || getenv("KITTY_WINDOW_ID") != NULL ||
+                   (term != NULL && strncmp(term, "foot", 4) == 0);
+
+    // Windows Terminal does all of it (platform_init switches the
+    // console to UTF-8)
+    if (getenv("WT_SESSION") != NULL) {
+        caps->colors = SCREEN_COLORS_24BIT;
+        caps->unicode = true;
+        caps->repeat = true;
+    }
+}
+
+bool screen_parse_caps(struct ScreenCaps *caps, const char *spec) {
+    char word[16];
+    const char *p = spec;
+
+    while (*p != '\0') {
+        size_t len = strcspn(p, ",");
+        if (len == 0 || len >= sizeof(word)) {
+            return false;
+        }
+        memcpy(word, p, len);
+        word[len] = '\0';
+        if (strcmp(word, "16") == 0) {
+            caps->colors = SCREEN_COLORS_16;
+        } else if (strcmp(word, "256") == 0) {
+            caps->colors = SCREEN_COLORS_256;
+        } else if (strcmp(word, "truecolor") == 0) {
+            caps->colors = SCREEN_COLORS_24BIT;
+        } else if (strcmp(word, "ascii") == 0) {
+            caps->unicode = false;
+        } else if (strcmp(word, "unicode") == 0) {
+            caps->unicode = true;
+        } else if (strcmp(word, "rep") == 0) {
+            caps->repeat = true;
+        } else if (strcmp(word, "norep") == 0) {
+            caps->repeat = false;
+        } else {
+            return false;
+        }
+        p = p + len;
+        if (*p == ',') {
+            p = p + 1;
+        }
+    }
+    return true;
+}
+
+void screen_init(struct Screen *screen, const struct ScreenCaps *caps) {
+    int i;
+
+    memset(screen, 0, sizeof(*screen));
+    screen->caps = *caps;
+
+    // Every style starts from a reset, so any one can follow any other
+    for (i = 0; i < STYLE_WALL; i++) {
+        int color = i & 7;
+        const char *bold = (i & STYLE_BOLD) ? ";1" : "";
+        if (color == STYLE_PLAIN) {
+            snprintf(screen->sgr[i], SCREEN_MAX_SGR, "\033[0%sm", bold);
+        } else {
+            snprintf(screen->sgr[i], SCREEN_MAX_SGR, "\033[0%s;%dm", bold, 30 + color);
+        }
+    }
+    for (i = STYLE_WALL; i < STYLE_COUNT; i++) {
+        const struct PieceColor *piece = &PIECE_COLORS[i - STYLE_WALL];
+        const char *bold = piece->bold ? ";1" : "";
+        if (caps->colors == SCREEN_COLORS_24BIT) {
+            snprintf(screen->sgr[i], SCREEN_MAX_SGR, "\033[0%s;38;2;%d;%d;%dm", bold,
+                     piece->red, piece->green, piece->blue);
+        } else if (caps->colors == SCREEN_COLORS_256) {
+            snprintf(screen->sgr[i], SCREEN_MAX_SGR, "\033[0%s;38;5;%dm", bold, piece->color256);
+        } else {
+            snprintf(screen->sgr[i], SCREEN_MAX_SGR, "\033[0%s;%dm", bold, piece->ansi);
+        }
+    }
+    for (i = 0; i < STYLE_COUNT; i++) {
+        screen->sgr_len[i] = (uint8_t)strlen(screen->sgr[i]);
+    }
+
+    for (i = 0; i < 256; i++) {
+        if (i == 0) {
+            strcpy(screen->glyphs[i], " ");
+        } else if (i < 128) {
+            screen->glyphs[i][0] = (char)i;
+        } else if (i < GLYPH_WALL + 16) {
+            strcpy(screen->glyphs[i], caps->unicode ? WALL_LINES[i - GLYPH_WALL] : "#");
+        } else {
+            strcpy(screen->glyphs[i], "?");
+        }
+        screen->glyph_len[i] = (uint8_t)strlen(screen->glyphs[i]);
+    }
+
+    screen_invalidate(screen);
+}
+
+void screen_invalidate(struct Screen *screen) {
+    screen->valid = false;
+}
+
+void screen_begin(struct Screen *screen, int top, int left, int rows, int cols) {
+    if (top != screen->top || left != screen->left) {
+        screen->top = top;
+        screen->left = left;
+        screen->valid = false;
+    }
+    screen->rows = rows < SCREEN_MAX_ROWS ? rows : SCREEN_MAX_ROWS;
+    screen->cols = cols < SCREEN_MAX_COLS ? cols : SCREEN_MAX_COLS;
+    memset(screen->cells, 0, sizeof(screen->cells));
+}
+
+int screen_text(struct Screen *screen, int row, int col, int style, const char *text) {
+    while (*text != '\0') {
+        screen_put(screen, row, col, (unsigned char)*text, style);
+        col = col + 1;
+        text = text + 1;
+    }
+    return col;
+}
+
+int count_digits(int n) {
+    int digits = 1;
+    while (n >= 10) {
+        n = n / 10;
+        digits = digits + 1;
+    }
+    return digits;
+}
+
+bool same_cell(struct ScreenCell a, struct ScreenCell b) {
+    return a.glyph == b.glyph && a.style == b.style;
+}
+
+// Last cell of a row that isn't blank, or -1
+int last_filled(const struct ScreenCell *row, int cols) {
+    int c = cols - 1;
+    while (c >= 0 && row[c].glyph == 0) {
+        c = c - 1;
+    }
+    return c;
+}
+
+// Bytes to move the cursor `n` cells right
+int forward_cost(int n) {
+    return n == 1 ? 3 : 3 + count_digits(n);
+}
+
+char *move_to(const struct Screen *screen, char *p, struct ScreenPen *pen, int row, int col) {
+    if (pen->row == row && pen->col == col) {
+        return p;
+    }
+    if (pen->row == row && pen->col >= 0 && col > pen->col) {
+        int n = col - pen->col;
+        p = p + (n == 1 ? sprintf(p, "\033[C") : sprintf(p, "\033[%dC", n));
+    } else {
+        p = p + sprintf(p, "\033[%d;%dH", screen->top + row + 1, screen->left + col + 1);
+    }
+    pen->row = row;
+    pen->col = col;
+    return p;
+}
+
+// Write cells [from, to) of a row where the cursor is
+char *put_cells(const struct Screen *screen, char *p, struct ScreenPen *pen,
+                const struct ScreenCell *cells, int from, int to) {
+    int i = from;
+
+    while (i < to) {
+        struct ScreenCell cell = cells[i];
+        int len = screen->glyph_len[cell.glyph];
+        int n = 1;
+
+        // Blanks look the same in any style, so leave it be
+        if (cell.glyph != 0 && cell.style != pen->style) {
+            memcpy(p, screen->sgr[cell.style], screen->sgr_len[cell.style]);
+            p = p + screen->sgr_len[cell.style];
+            pen->style = cell.style;
+        }
+        memcpy(p, screen->glyphs[cell.glyph], (size_t)len);
+        p = p + len;
+
+        if (screen->caps.repeat) {
+            while (i + n < to && same_cell(cells[i + n], cell)) {
+                n = n + 1;
+            }
+            if (n > 1 && 3 + count_digits(n - 1) < len * (n - 1)) {
+                p = p + sprintf(p, "\033[%db", n - 1);
+            } else {
+                n = 1;
+            }
+        }
+        i = i + n;
+    }
+    pen->col = pen->col + (to - from);
+    return p;
+}
+
+// Write one row that changed, whichever way is shorter: the changed runs
+// with cursor moves between them, or the whole row.
+char *put_row(struct Screen *screen, char *p, int row, int cols) {
+    const struct ScreenCell *next = screen->cells[row];
+    const struct ScreenCell *old = screen->shown[row];
+    int last_next = last_filled(next, cols);
+    int last_old = last_filled(old, cols);
+    int c = 0;
+
+    // The whole row, then clear whatever was left past its end
+    struct ScreenPen whole_pen = screen->pen;
+    char *whole = screen->row_bytes[0];
+    char *w = move_to(screen, whole, &whole_pen, row, 0);
+    w = put_cells(screen, w, &whole_pen, next, 0, last_next + 1);
+    if (last_old > last_next) {
+        w = w + sprintf(w, "\033[K");
+    }
+
+    // Just what changed. Short stretches that didn't change are written
+    // again when that's no longer than moving the cursor past them.
+    // Anything past the end of the new row is cleared in one go.
+    struct ScreenPen runs_pen = screen->pen;
+    char *runs = screen->row_bytes[1];
+    char *q = runs;
+    int end = last_old > last_next ? last_next + 1 : cols;
+    while (true) {
+        while (c < end && same_cell(next[c], old[c])) {
+            c = c + 1;
+        }
+        if (c >= end) {
+            break;
+        }
+        q = move_to(screen, q, &runs_pen, row, c);
+        while (c < end) {
+            int run_end = c;
+            while (run_end < end && same_cell(next[run_end], old[run_end]) == false) {
+                run_end = run_end + 1;
+            }
+            q = put_cells(screen, q, &runs_pen, next, c, run_end);
+            c = run_end;
+
+            int gap_end = c;
+            while (gap_end < end && same_cell(next[gap_end], old[gap_end])) {
+                gap_end = gap_end + 1;
+            }
+            if (gap_end == end) {
+                break;
+            }
+            struct ScreenPen gap_pen = runs_pen;
+            char *gap = screen->row_bytes[2];
+            int gap_len = (int)(put_cells(screen, gap, &gap_pen, next, c, gap_end) - gap);
+            if (gap_len > forward_cost(gap_end - c)) {
+                break;
+            }
+            memcpy(q, gap, (size_t)gap_len);
+            q = q + gap_len;
+            runs_pen = gap_pen;
+            c = gap_end;
+        }
+    }
+    if (last_old > last_next) {
+        q = move_to(screen, q, &runs_pen, row, last_next + 1);
+        q = q + sprintf(q, "\033[K");
+    }
+
+    if (q - runs <= w - whole) {
+        memcpy(p, runs, (size_t)(q - runs));
+        screen->pen = runs_pen;
+        return p + (q - runs);
+    }
+    memcpy(p, whole, (size_t)(w - whole));
+    screen->pen = whole_pen;
+    return p + (w - whole);
+}
+
+int screen_encode(struct Screen *screen, char *buf) {
+    char *p = buf;
+    int rows = screen->rows > screen->shown_rows ? screen->rows : screen->shown_rows;
+    int cols = screen->cols > screen->shown_cols ? screen->cols : screen->shown_cols;
+    int r;
+
+    if (screen->valid == false) {
+        p = p + sprintf(p, "\033[0m\033[2J");
+        memset(screen->shown, 0, sizeof(screen->shown));
+        screen->pen.style = STYLE_PLAIN;
+        screen->pen.row = -1;
+        screen->pen.col = -1;
+        screen->valid = true;
+    }
+
+    // Cells outside this frame were cleared by screen_begin, so rows and
+    // columns the last frame had and this one doesn't get blanked
+    for (r = 0; r < rows; r++) {
+        if (memcmp(screen->cells[r], screen->shown[r], (size_t)cols * sizeof(struct ScreenCell)) != 0) {
+            p = put_row(screen, p, r, cols);
+            memcpy(screen->shown[r], screen->cells[r], (size_t)cols * sizeof(struct ScreenCell));
+        }
+    }
+    screen->shown_rows = screen->rows;
+    screen->shown_cols = screen->cols;
+    return (int)(p - buf);
+}
@@ -0,0 +1,137 @@
+/*
+ * Screen output.
+ *
+ * The renderer draws each frame into a grid of cells, a glyph and a
+ * style each, and this turns the grid into bytes for the terminal. Only
+ * cells that differ from what the terminal already shows are sent, and
+ * each row goes out whichever way takes fewest bytes: moving the cursor
+ * to each changed run, or rewriting the whole row. Where the terminal
+ * understands REP, a long run of the same cell is sent as one character
+ * and a repeat count.
+ *
+ * What a style or glyph turns into depends on the terminal: 16 colours
+ * and '#' walls work everywhere, 256 and 24-bit colour give the walls,
+ * dots and ghosts their arcade colours, and a UTF-8 terminal gets walls
+ * drawn with joined-up box-drawing lines. screen_init turns all of that
+ * into byte strings once, so a frame costs the same to build whichever
+ * one is used.
+ *
+ * Frames are diffed against the last one encoded, so that one has to
+ * reach the terminal. If it might not have (the terminal was resized or
+ * output was dropped), call screen_invalidate and the next frame clears
+ * the screen and is sent whole.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// How many colours the terminal has
+#define SCREEN_COLORS_16 0
+#define SCREEN_COLORS_256 1
+#define SCREEN_COLORS_24BIT 2
+
+struct ScreenCaps {
+    int colors;       // SCREEN_COLORS_*
+    bool unicode;     // UTF-8, so walls can be box-drawing lines
+    bool repeat;      // Understands REP (CSI n b: repeat the last character)
+};
+
+// Text styles: a colour, plus STYLE_BOLD
+#define STYLE_PLAIN   0
+#define STYLE_RED     1
+#define STYLE_GREEN   2
+#define STYLE_YELLOW  3
+#define STYLE_BLUE    4
+#define STYLE_MAGENTA 5
+#define STYLE_CYAN    6
+#define STYLE_WHITE   7
+#define STYLE_BOLD    8
+
+// Game pieces, which get their own colours on terminals with more than 16
+#define STYLE_WALL   16
+#define STYLE_DOT    17
+#define STYLE_PACMAN 18
+#define STYLE_GHOST  19   // Plus the ghost type
+#define STYLE_COUNT  23
+
+// A glyph is an ASCII character, or GLYPH_WALL plus the wall's shape
+// (WALL_* from level.h). 0 is a blank cell.
+#define GLYPH_WALL 128
+
+// Biggest grid: the largest maze view and the text around it
+#define SCREEN_MAX_ROWS 68
+#define SCREEN_MAX_COLS 164
+
+// Longest escape sequence for a style, and longest glyph
+#define SCREEN_MAX_SGR 24
+#define SCREEN_MAX_GLYPH 4
+
+// Most bytes one row of a frame, and a whole frame, can take
+#define SCREEN_ROW_BYTES (32 + SCREEN_MAX_COLS * (SCREEN_MAX_SGR + SCREEN_MAX_GLYPH))
+#define SCREEN_MAX_BYTES (32 + SCREEN_MAX_ROWS * SCREEN_ROW_BYTES)
+
+struct ScreenCell {
+    uint8_t glyph;
+    uint8_t style;
+};
+
+// Where the terminal's cursor and colours are while a frame is written
+struct ScreenPen {
+    int style;        // -1 = not known
+    int row;          // In grid cells, -1 = not known
+    int col;
+};
+
+struct Screen {
+    struct ScreenCaps caps;
+    char sgr[STYLE_COUNT][SCREEN_MAX_SGR];       // Escape sequence for each style
+    uint8_t sgr_len[STYLE_COUNT];
+    char glyphs[256][SCREEN_MAX_GLYPH];          // Bytes for each glyph
+    uint8_t glyph_len[256];
+
+    int top, left;        // Where the grid sits on the terminal
+    int rows, cols;       // Part of the grid this frame uses
+    int shown_rows;       // ...and the last frame used
+    int shown_cols;
+    bool valid;           // false: clear the terminal and send everything
+    struct ScreenPen pen;
+
+    struct ScreenCell cells[SCREEN_MAX_ROWS][SCREEN_MAX_COLS];   // Frame being drawn
+    struct ScreenCell shown[SCREEN_MAX_ROWS][SCREEN_MAX_COLS];   // What the terminal has
+    char row_bytes[3][SCREEN_ROW_BYTES];                         // Scratch for choosing encodings
+};
+
+// Work out what the terminal can do from the environment
+void screen_detect(struct ScreenCaps *caps);
+
+// Change caps from a comma-separated list: 16, 256, truecolor, ascii,
+// unicode, rep, norep. False if a word isn't one of those.
+bool screen_parse_caps(struct ScreenCaps *caps, const char *spec);
+
+// Set up the byte strings for a terminal. The first frame is sent whole.
+void screen_init(struct Screen *screen, const struct ScreenCaps *caps);
+
+// Send the next frame whole
+void screen_invalidate(struct Screen *screen);
+
+// Start a frame of rows x cols cells at row `top`, column `left` of the
+// terminal. Every cell starts blank.
+void screen_begin(struct Screen *screen, int top, int left, int rows, int cols);
+
+static inline void screen_put(struct Screen *screen, int row, int col, int glyph, int style) {
+    if (row < screen->rows && col < screen->cols) {
+        struct ScreenCell *cell = &screen->cells[row][col];
+        // Blanks look the same in every style
+        cell->glyph = glyph == ' ' ? 0 : (uint8_t)glyph;
+        cell->style = glyph == ' ' ? 0 : (uint8_t)style;
+    }
+}
+
+// Put text at row/col. Returns the column after it.
+int screen_text(struct Screen *screen, int row, int col, int style, const char *text);
+
+// Write what changed since the last frame to `buf` (SCREEN_MAX_BYTES
+// long). Returns the number of bytes, 0 if nothing changed.
+int screen_encode(struct Screen *screen, char *buf);
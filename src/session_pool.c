@@ -0,0 +1,54 @@
+#include "session_pool.h"
+#include "platform.h"
+
+#include <stdlib.h>
+
+bool session_pool_create(struct SessionPool *pool, const struct Level *level, int capacity) {
+    pool->level = level;
+    pool->stride = app_session_size(level);
+    pool->capacity = capacity;
+    pool->used = 0;
+    pool->free_head = -1;
+    pool->next_free = malloc((size_t)capacity * sizeof(int));
+    pool->memory = platform_aligned_alloc(CACHE_LINE_SIZE, pool->stride * (size_t)capacity);
+    if (pool->next_free == NULL || pool->memory == NULL) {
+        session_pool_destroy(pool);
+        return false;
+    }
+    return true;
+}
+
+void session_pool_destroy(struct SessionPool *pool) {
+    free(pool->next_free);
+    platform_aligned_free(pool->memory);
+    pool->next_free = NULL;
+    pool->memory = NULL;
+    pool->capacity = 0;
+    pool->used = 0;
+}
+
+struct App *session_pool_acquire(struct SessionPool *pool, int flags) {
+    int slot;
+
+    // Reuse a released slot first, then take a new one
+    if (pool->free_head >= 0) {
+        slot = pool->free_head;
+        pool->free_head = pool->next_free[slot];
+    } else if (pool->used < pool->capacity) {
+        slot = pool->used;
+        pool->used = pool->used + 1;
+    } else {
+        return NULL;
+    }
+
+    struct App *app = (struct App *)(pool->memory + pool->stride * (size_t)slot);
+    app_init(app, pool->level, flags);
+    app->id = (uint32_t)slot;
+    return app;
+}
+
+void session_pool_release(struct SessionPool *pool, struct App *app) {
+    int slot = (int)(((unsigned char *)app - pool->memory) / pool->stride);
+    pool->next_free[slot] = pool->free_head;
+    pool->free_head = slot;
+}
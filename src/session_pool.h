@@ -0,0 +1,33 @@
+/*
+ * Session pool.
+ *
+ * Hands out game sessions from one big block of memory instead of one
+ * allocation each. Every slot is an App followed by its dots, padded to
+ * a cache line, so sessions never share a line with each other.
+ */
+
+#pragma once
+
+#include "app.h"
+
+struct SessionPool {
+    const struct Level *level;
+    size_t stride;      // Bytes per slot
+    int capacity;
+    int used;           // Slots handed out so far (never goes down)
+    int free_head;      // First released slot, or -1
+    int *next_free;     // Free list links, one per slot
+    unsigned char *memory;
+};
+
+// Make room for `capacity` sessions of `level`
+bool session_pool_create(struct SessionPool *pool, const struct Level *level, int capacity);
+
+// Free the pool and every session in it
+void session_pool_destroy(struct SessionPool *pool);
+
+// Get a fresh session, or NULL if the pool is full
+struct App *session_pool_acquire(struct SessionPool *pool, int flags);
+
+// Give a session back to the pool
+void session_pool_release(struct SessionPool *pool, struct App *app);
@@ -0,0 +1,183 @@
+#include "shared_state.h"
+#include "app.h"
+#include "atomics.h"
+#include "platform.h"
+
+#include <string.h>
+
+// Round up to a whole cache line
+size_t shared_state_align(size_t size) {
+    return (size + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE * CACHE_LINE_SIZE;
+}
+
+bool shared_state_create(struct SharedStateWriter *writer, const char *name, const struct Level *level) {
+    size_t bits = (size_t)level->words * sizeof(uint64_t);
+    size_t state_offset = shared_state_align(sizeof(struct SharedStateHeader));
+    size_t walls_offset = state_offset + shared_state_align(sizeof(struct SharedState));
+    size_t dots_offset = walls_offset + shared_state_align(bits);
+    size_t size = dots_offset + shared_state_align(bits);
+
+    memset(writer, 0, sizeof(*writer));
+    writer->segment = platform_shm_create(name, size);
+    if (writer->segment == NULL) {
+        return false;
+    }
+    writer->name = name;
+    writer->size = size;
+    writer->header = (struct SharedStateHeader *)writer->segment;
+    writer->state = (struct SharedState *)(writer->segment + state_offset);
+    writer->walls = (uint64_t *)(writer->segment + walls_offset);
+    writer->dots = (uint64_t *)(writer->segment + dots_offset);
+    writer->dots_first = UINT32_MAX;
+    writer->dots_last = 0;
+
+    struct SharedStateHeader *header = writer->header;
+    header->version = SHARED_STATE_VERSION;
+    header->header_size = sizeof(struct SharedStateHeader);
+    header->state_size = sizeof(struct SharedState);
+    header->rows = (uint32_t)level->rows;
+    header->cols = (uint32_t)level->cols;
+    header->words = (uint32_t)level->words;
+    header->ghosts = NUM_GHOSTS;
+    header->state_offset = state_offset;
+    header->walls_offset = walls_offset;
+    header->dots_offset = dots_offset;
+    header->segment_size = size;
+
+    // Readers ignore the segment until the magic is there
+    atom_fence();
+    header->magic = SHARED_STATE_MAGIC;
+    return true;
+}
+
+void shared_state_publish(struct SharedStateWriter *writer, const struct App *app) {
+    struct SharedState *state = writer->state;
+    const struct Level *level = app->level;
+    uint64_t seq = writer->header->seq;
+    int i;
+
+    if ((uint32_t)level->words != writer->header->words) {
+        return;
+    }
+
+    atom_store64(&writer->header->seq, seq + 1);
+    atom_fence();
+
+    state->updates = state->updates + 1;
+    state->time_ns = platform_time_ns();
+    state->tick = app->timers.now;
+    state->status = (app->won ? SHARED_STATE_WON : 0) | (app->game_over ? SHARED_STATE_GAME_OVER : 0);
+    state->level = (uint32_t)level->number;
+    state->score = app->score;
+    state->high_score = app->high_score;
+    state->lives = app->lives;
+    state->max_lives = app->max_lives;
+    state->dots_remaining = app->dots_remaining;
+    state->pacman_row = app->pacman.row;
+    state->pacman_col = app->pacman.col;
+    state->pacman_dir = app->pacman_dir;
+    for (i = 0; i < NUM_GHOSTS; i++) {
+        state->ghosts[i].row = app->ghosts[i].pos.row;
+        state->ghosts[i].col = app->ghosts[i].pos.col;
+        state->ghosts[i].type = app->ghosts[i].type;
+        state->ghosts[i].dir = app->ghosts[i].last_dir;
+    }
+
+    // A new level (campaign levels reuse the same memory, so check its
+    // number too) is copied whole. Otherwise only the dot words eaten
+    // since the level started can differ, now or at the last copy.
+    const uint64_t *dots = app_dots_const(app);
+    if (level != writer->level || level->number != writer->level_number) {
+        memcpy(writer->walls, level->walls, (size_t)level->words * sizeof(uint64_t));
+        memcpy(writer->dots, dots, (size_t)level->words * sizeof(uint64_t));
+        writer->level = level;
+        writer->level_number = level->number;
+        state->mazes = state->mazes + 1;
+    } else {
+        uint32_t first = app->dots_first < writer->dots_first ? app->dots_first : writer->dots_first;
+        uint32_t last = app->dots_last > writer->dots_last ? app->dots_last : writer->dots_last;
+        if (first <= last) {
+            memcpy(writer->dots + first, dots + first, (size_t)(last - first + 1) * sizeof(uint64_t));
+        }
+    }
+    writer->dots_first = app->dots_first;
+    writer->dots_last = app->dots_last;
+
+    atom_store64(&writer->header->seq, seq + 2);
+}
+
+void shared_state_destroy(struct SharedStateWriter *writer) {
+    uint64_t seq = writer->header->seq;
+
+    atom_store64(&writer->header->seq, seq + 1);
+    atom_fence();
+    writer->state->status = writer->state->status | SHARED_STATE_EXITED;
+    writer->state->updates = writer->state->updates + 1;
+    atom_store64(&writer->header->seq, seq + 2);
+
+    platform_shm_close(writer->segment, writer->size, writer->name);
+    writer->segment = NULL;
+}
+
+bool shared_state_open(struct SharedStateReader *reader, const char *name) {
+    const struct SharedStateHeader *header;
+
+    memset(reader, 0, sizeof(*reader));
+    reader->segment = platform_shm_open(name, &reader->size);
+    if (reader->segment == NULL) {
+        return false;
+    }
+    header = (const struct SharedStateHeader *)reader->segment;
+
+    // Check everything the reader relies on before trusting any offset
+    if (reader->size < sizeof(struct SharedStateHeader) || header->magic != SHARED_STATE_MAGIC ||
+        header->version != SHARED_STATE_VERSION || header->segment_size > reader->size ||
+        header->state_offset + header->state_size > header->segment_size ||
+        header->walls_offset + (uint64_t)header->words * 8 > header->segment_size ||
+        header->dots_offset + (uint64_t)header->words * 8 > header->segment_size) {
+        platform_shm_close(reader->segment, reader->size, NULL);
+        reader->segment = NULL;
+        return false;
+    }
+    atom_fence();
+    reader->header = header;
+    return true;
+}
+
+bool shared_state_read(struct SharedStateReader *reader, struct SharedState *state,
+                       uint64_t *walls, uint64_t *dots) {
+    const struct SharedStateHeader *header = reader->header;
+    const volatile uint64_t *seq = &header->seq;
+    size_t state_size = header->state_size < sizeof(*state) ? header->state_size : sizeof(*state);
+    size_t bits = (size_t)header->words * sizeof(uint64_t);
+    int tries;
+
+    memset(state, 0, sizeof(*state));
+    for (tries = 0; tries < SHARED_STATE_READ_TRIES; tries++) {
+        uint64_t before = atom_load64_readonly(seq);
+        if ((before & 1) == 0) {
+            // The game may be writing these right now; the sequence
+            // number says afterwards whether the copy can be kept
+            memcpy(state, reader->segment + header->state_offset, state_size);
+            if (walls != NULL) {
+                memcpy(walls, reader->segment + header->walls_offset, bits);
+            }
+            if (dots != NULL) {
+                memcpy(dots, reader->segment + header->dots_offset, bits);
+            }
+            atom_fence();
+            if (atom_load64_readonly(seq) == before) {
+                return true;
+            }
+        }
+        reader->retries = reader->retries + 1;
+    }
+    return false;
+}
+
+void shared_state_close(struct SharedStateReader *reader) {
+    if (reader->segment != NULL) {
+        platform_shm_close(reader->segment, reader->size, NULL);
+        reader->segment = NULL;
+    }
+}
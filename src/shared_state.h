@@ -0,0 +1,134 @@
+/*
+ * Live game state for other processes.
+ *
+ * With --share NAME the game keeps a copy of its state in named shared
+ * memory (platform_shm_create), so dashboards, bots and test oracles can
+ * follow a game without reading its screen. The game never waits for a
+ * reader: the copy is guarded by a sequence lock. The game makes the
+ * sequence number odd, writes, then makes it even again. A reader copies
+ * what it wants and keeps the copy only if the number was the same even
+ * value before and after; otherwise it tries again.
+ *
+ * The segment, with every integer in the machine's own byte order:
+ *
+ *   SharedStateHeader   at 0. Set up once before the magic is written,
+ *                       apart from `seq`.
+ *   SharedState         at header.state_offset, header.state_size bytes
+ *   walls               at header.walls_offset: header.words uint64s
+ *   dots                at header.dots_offset:  header.words uint64s
+ *
+ * The walls and dots are bit sets like the ones in level.h: cell
+ * (row, col) is bit n % 64 of word n / 64, where n = row * cols + col.
+ * Readers should check the magic and version and go by the header's
+ * offsets and sizes, not their own sizeof, so later versions can add
+ * fields to the end of each part.
+ *
+ * `pacman_watch` follows a game from another terminal.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "level.h"
+
+#define SHARED_STATE_MAGIC 0x53534d50u  // "PMSS"
+#define SHARED_STATE_VERSION 1
+
+// SharedState.status bits
+#define SHARED_STATE_WON       1
+#define SHARED_STATE_GAME_OVER 2
+#define SHARED_STATE_EXITED    4    // The game has quit: nothing changes any more
+
+// Times a reader tries before giving up on a copy
+#define SHARED_STATE_READ_TRIES 100
+
+struct SharedStateHeader {
+    uint32_t magic;             // SHARED_STATE_MAGIC once everything else is set up
+    uint32_t version;           // SHARED_STATE_VERSION
+    uint32_t header_size;
+    uint32_t state_size;
+    uint32_t rows;
+    uint32_t cols;
+    uint32_t words;             // uint64s in each bit set
+    uint32_t ghosts;
+    uint64_t state_offset;
+    uint64_t walls_offset;
+    uint64_t dots_offset;
+    uint64_t segment_size;
+    _Alignas(64) volatile uint64_t seq;   // Odd while the game is writing
+};
+
+struct SharedGhost {
+    int32_t row;
+    int32_t col;
+    int32_t type;               // GHOST_* from app.h
+    int32_t dir;                // Last direction moved (GHOST_DIR_*), -1 = none yet
+};
+
+struct SharedState {
+    uint64_t updates;           // States written so far
+    int64_t time_ns;            // When this one was written (platform_time_ns)
+    uint32_t tick;              // Ticks (APP_TICK_MS) since the level started or restarted
+    uint32_t status;            // SHARED_STATE_* bits
+    uint32_t level;             // Campaign level, 0 = not part of one
+    uint32_t mazes;             // Goes up every time the walls change
+    uint32_t score;
+    uint32_t high_score;
+    uint32_t lives;
+    uint32_t max_lives;
+    uint32_t dots_remaining;
+    int32_t pacman_row;
+    int32_t pacman_col;
+    int32_t pacman_dir;         // GHOST_DIR_*
+    struct SharedGhost ghosts[NUM_GHOSTS];
+};
+
+// Game side
+struct SharedStateWriter {
+    const char *name;
+    unsigned char *segment;
+    size_t size;
+    struct SharedStateHeader *header;
+    struct SharedState *state;
+    uint64_t *walls;
+    uint64_t *dots;
+    const struct Level *level;  // Level the walls came from
+    int level_number;
+    uint32_t dots_first;        // Dot words that may differ from the level's
+    uint32_t dots_last;         // start (first > last: none)
+};
+
+struct App;
+
+// Share games on levels the size of `level` under `name`
+bool shared_state_create(struct SharedStateWriter *writer, const char *name, const struct Level *level);
+
+// Game thread: write the game's current state
+void shared_state_publish(struct SharedStateWriter *writer, const struct App *app);
+
+// Mark the game as exited and remove the name. Readers that have it
+// mapped keep what they have.
+void shared_state_destroy(struct SharedStateWriter *writer);
+
+// Reader side
+struct SharedStateReader {
+    const unsigned char *segment;
+    size_t size;
+    const struct SharedStateHeader *header;
+    uint64_t retries;           // Copies thrown away because the game was writing
+};
+
+// Map a game shared under `name`. False if there is none yet, or its
+// layout isn't one this reader understands.
+bool shared_state_open(struct SharedStateReader *reader, const char *name);
+
+// Copy the newest state. `walls` and `dots` can be NULL; otherwise they
+// must have room for header->words uint64s. Returns false if the game
+// was writing every time (SHARED_STATE_READ_TRIES).
+bool shared_state_read(struct SharedStateReader *reader, struct SharedState *state,
+                       uint64_t *walls, uint64_t *dots);
+
+void shared_state_close(struct SharedStateReader *reader);
@@ -0,0 +1,27 @@
+#include "spsc_queue.h"
+#include "atomics.h"
+
+void spsc_queue_init(struct SpscQueue *queue) {
+    queue->head = 0;
+    queue->tail = 0;
+}
+
+bool spsc_queue_push(struct SpscQueue *queue, int item) {
+    int tail = queue->tail;
+    if (tail - atom_load(&queue->head) == SPSC_QUEUE_SIZE) {
+        return false;
+    }
+    queue->items[tail & (SPSC_QUEUE_SIZE - 1)] = item;
+    atom_store(&queue->tail, tail + 1);
+    return true;
+}
+
+bool spsc_queue_pop(struct SpscQueue *queue, int *item) {
+    int head = queue->head;
+    if (head == atom_load(&queue->tail)) {
+        return false;
+    }
+    *item = queue->items[head & (SPSC_QUEUE_SIZE - 1)];
+    atom_store(&queue->head, head + 1);
+    return true;
+}
@@ -0,0 +1,29 @@
+/*
+ * Single-producer, single-consumer queue of ints.
+ *
+ * One thread pushes and one other thread pops, with no locks. Used to
+ * hand key presses from the input thread to the simulation thread.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+
+#include "app.h"
+
+// Must be a power of two
+#define SPSC_QUEUE_SIZE 256
+
+struct SpscQueue {
+    _Alignas(CACHE_LINE_SIZE) volatile int head;  // Next slot to pop (consumer)
+    _Alignas(CACHE_LINE_SIZE) volatile int tail;  // Next slot to push (producer)
+    int items[SPSC_QUEUE_SIZE];
+};
+
+void spsc_queue_init(struct SpscQueue *queue);
+
+// Add an item; returns false if the queue is full
+bool spsc_queue_push(struct SpscQueue *queue, int item);
+
+// Take the oldest item; returns false if the queue is empty
+bool spsc_queue_pop(struct SpscQueue *queue, int *item);
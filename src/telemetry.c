@@ -0,0 +1,376 @@
+#include "telemetry.h"
+#include "platform.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define TELEMETRY_MAGIC "PMTL"
+#define TELEMETRY_VERSION 1
+
+#define TELEMETRY_COLUMNS 7
+
+// Worst case bytes for one column of a block: a 5-byte varint per event
+#define COLUMN_CAP (TELEMETRY_BLOCK_EVENTS * 5)
+
+struct Telemetry {
+    struct TelemetryBuffer buffers[TELEMETRY_MAX_THREADS];
+    volatile int buffer_count;             // Slots handed out so far
+
+    FILE *file;
+    struct TelemetryEvent *block;          // Events being encoded (writer thread)
+    unsigned char *columns[TELEMETRY_COLUMNS];
+    uint64_t events;                       // Writer thread only
+    uint64_t file_bytes;                   // Writer thread only
+
+    struct PlatformThread *thread;
+    volatile int stop;
+};
+
+struct Telemetry g_tel;
+bool g_telemetry_running = false;
+TELEMETRY_THREAD_LOCAL struct TelemetryBuffer *t_telemetry = NULL;
+
+const char *telemetry_type_name(int type) {
+    static const char *names[TELEMETRY_EVENT_TYPES] = {"dot", "life_lost", "ghost_move", "win", "game_over", "ghost_cheap_move"};
+    if (type < 0 || type >= TELEMETRY_EVENT_TYPES) {
+        return "unknown";
+    }
+    return names[type];
+}
+
+void put_u32(unsigned char *p, uint32_t value) {
+    p[0] = (unsigned char)value;
+    p[1] = (unsigned char)(value >> 8);
+    p[2] = (unsigned char)(value >> 16);
+    p[3] = (unsigned char)(value >> 24);
+}
+
+uint32_t get_u32(const unsigned char *p) {
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+// Zigzag LEB128: 0, -1, 1, -2 ... become 0, 1, 2, 3 ..., 7 bits a byte
+unsigned char *put_delta(unsigned char *p, uint32_t value, uint32_t previous) {
+    int32_t diff = (int32_t)(value - previous);
+    uint32_t zigzag = ((uint32_t)diff << 1) ^ (uint32_t)(diff >> 31);
+    while (zigzag >= 0x80) {
+        *p = (unsigned char)(zigzag | 0x80);
+        p = p + 1;
+        zigzag = zigzag >> 7;
+    }
+    *p = (unsigned char)zigzag;
+    return p + 1;
+}
+
+// Returns NULL if the varint runs past `end`
+const unsigned char *get_delta(const unsigned char *p, const unsigned char *end, uint32_t *value) {
+    uint32_t zigzag = 0;
+    int shift = 0;
+    while (p < end && shift < 35) {
+        zigzag = zigzag | (uint32_t)(*p & 0x7f) << shift;
+        if ((*p & 0x80) == 0) {
+            *value = *value + ((zigzag >> 1) ^ (0u - (zigzag & 1)));
+            return p + 1;
+        }
+        p = p + 1;
+        shift = shift + 7;
+    }
+    return NULL;
+}
+
+// Encode `count` events from g_tel.block and write them as one block
+void write_block(int count) {
+    const struct TelemetryEvent *events = g_tel.block;
+    unsigned char *out[TELEMETRY_COLUMNS];
+    unsigned char header[4];
+    uint32_t tick = 0, session = 0, row = 0, col = 0;
+    int i, c;
+
+    for (c = 0; c < TELEMETRY_COLUMNS; c++) {
+        out[c] = g_tel.columns[c];
+    }
+    for (i = 0; i < count; i++) {
+        const struct TelemetryEvent *event = &events[i];
+        out[0] = put_delta(out[0], event->tick, tick);
+        out[1] = put_delta(out[1], event->session, session);
+        out[2][0] = event->type;
+        out[3] = put_delta(out[3], event->row, row);
+        out[4] = put_delta(out[4], event->col, col);
+        out[5][0] = event->ghost;
+        out[6][0] = event->dir;
+        out[2] = out[2] + 1;
+        out[5] = out[5] + 1;
+        out[6] = out[6] + 1;
+        tick = event->tick;
+        session = event->session;
+        row = event->row;
+        col = event->col;
+    }
+
+    put_u32(header, (uint32_t)count);
+    fwrite(header, 1, 4, g_tel.file);
+    g_tel.file_bytes = g_tel.file_bytes + 4;
+    for (c = 0; c < TELEMETRY_COLUMNS; c++) {
+        uint32_t len = (uint32_t)(out[c] - g_tel.columns[c]);
+        put_u32(header, len);
+        fwrite(header, 1, 4, g_tel.file);
+        fwrite(g_tel.columns[c], 1, len, g_tel.file);
+        g_tel.file_bytes = g_tel.file_bytes + 4 + len;
+    }
+    g_tel.events = g_tel.events + (uint64_t)count;
+}
+
+// Write out everything one thread has logged so far
+void drain_buffer(struct TelemetryBuffer *buf) {
+    uint64_t tail = atom_load64(&buf->tail);
+    uint64_t head = buf->head;
+
+    while (head != tail) {
+        int count = 0;
+        while (head != tail && count < TELEMETRY_BLOCK_EVENTS) {
+            g_tel.block[count] = buf->events[head & (TELEMETRY_RING_EVENTS - 1)];
+            head = head + 1;
+            count = count + 1;
+        }
+        atom_store64(&buf->head, head);
+        write_block(count);
+    }
+}
+
+// Disk writer thread
+void telemetry_thread(void *arg) {
+    int i;
+    (void)arg;
+
+    while (true) {
+        int stopping = atom_load(&g_tel.stop);
+        int count = atom_load(&g_tel.buffer_count);
+        if (count > TELEMETRY_MAX_THREADS) count = TELEMETRY_MAX_THREADS;
+
+        for (i = 0; i < count; i++) {
+            if (atom_load(&g_tel.buffers[i].ready)) {
+                drain_buffer(&g_tel.buffers[i]);
+            }
+        }
+
+        if (stopping) {
+            break;
+        }
+        platform_sleep_ms(5);
+    }
+    fflush(g_tel.file);
+}
+
+bool telemetry_make_room(struct TelemetryBuffer *buf) {
+    buf->limit = atom_load64(&buf->head) + TELEMETRY_RING_EVENTS;
+    if (buf->tail == buf->limit) {
+        buf->dropped = buf->dropped + 1;
+        return false;
+    }
+    return true;
+}
+
+void telemetry_attach() {
+    if (g_telemetry_running == false || t_telemetry != NULL) {
+        return;
+    }
+
+    int slot = atom_add(&g_tel.buffer_count, 1);
+    if (slot >= TELEMETRY_MAX_THREADS) {
+        fprintf(stderr, "Warning: too many threads for telemetry, not logging thread %d\n", slot);
+        return;
+    }
+    struct TelemetryBuffer *buf = &g_tel.buffers[slot];
+    buf->events = malloc(TELEMETRY_RING_EVENTS * sizeof(struct TelemetryEvent));
+    if (buf->events == NULL) {
+        fprintf(stderr, "Warning: out of memory for telemetry\n");
+        return;
+    }
+
+    // Touch the whole ring now so the game never takes page faults on it
+    memset(buf->events, 0, TELEMETRY_RING_EVENTS * sizeof(struct TelemetryEvent));
+    buf->limit = TELEMETRY_RING_EVENTS;
+    atom_store(&buf->ready, 1);
+    t_telemetry = buf;
+}
+
+void free_writer_buffers() {
+    int c;
+    free(g_tel.block);
+    g_tel.block = NULL;
+    for (c = 0; c < TELEMETRY_COLUMNS; c++) {
+        free(g_tel.columns[c]);
+        g_tel.columns[c] = NULL;
+    }
+}
+
+bool telemetry_start(const char *path) {
+    unsigned char header[8];
+    bool ok;
+    int c;
+
+    memset(&g_tel, 0, sizeof(g_tel));
+    g_tel.block = malloc(TELEMETRY_BLOCK_EVENTS * sizeof(struct TelemetryEvent));
+    ok = g_tel.block != NULL;
+    for (c = 0; c < TELEMETRY_COLUMNS; c++) {
+        g_tel.columns[c] = malloc(COLUMN_CAP);
+        ok = ok && g_tel.columns[c] != NULL;
+    }
+    g_tel.file = ok ? fopen(path, "wb") : NULL;
+    if (g_tel.file == NULL) {
+        perror(path);
+        free_writer_buffers();
+        return false;
+    }
+
+    memcpy(header, TELEMETRY_MAGIC, 4);
+    put_u32(header + 4, TELEMETRY_VERSION);
+    fwrite(header, 1, 8, g_tel.file);
+    g_tel.file_bytes = 8;
+
+    g_tel.thread = platform_thread_start(telemetry_thread, NULL);
+    if (g_tel.thread == NULL) {
+        fclose(g_tel.file);
+        free_writer_buffers();
+        return false;
+    }
+
+    g_telemetry_running = true;
+    return true;
+}
+
+void telemetry_stop(struct TelemetryStats *stats) {
+    int i;
+
+    if (g_telemetry_running == false) {
+        return;
+    }
+    g_telemetry_running = false;
+    t_telemetry = NULL;
+
+    atom_store(&g_tel.stop, 1);
+    platform_thread_join(g_tel.thread);
+    fclose(g_tel.file);
+
+    int count = g_tel.buffer_count < TELEMETRY_MAX_THREADS ? g_tel.buffer_count : TELEMETRY_MAX_THREADS;
+    uint64_t dropped = 0;
+    for (i = 0; i < count; i++) {
+        dropped = dropped + g_tel.buffers[i].dropped;
+        free(g_tel.buffers[i].events);
+    }
+    if (stats != NULL) {
+        stats->events = g_tel.events;
+        stats->dropped = dropped;
+        stats->file_bytes = g_tel.file_bytes;
+    }
+    free_writer_buffers();
+}
+
+bool telemetry_reader_open(struct TelemetryReader *reader, const char *path) {
+    unsigned char header[8];
+
+    memset(reader, 0, sizeof(*reader));
+    reader->file = fopen(path, "rb");
+    if (reader->file == NULL) {
+        perror(path);
+        return false;
+    }
+    if (fread(header, 1, 8, reader->file) != 8 || memcmp(header, TELEMETRY_MAGIC, 4) != 0) {
+        fprintf(stderr, "Error: %s is not a telemetry log\n", path);
+        fclose(reader->file);
+        return false;
+    }
+    if (get_u32(header + 4) != TELEMETRY_VERSION) {
+        fprintf(stderr, "Error: %s is telemetry version %u, expected %d\n", path,
+                get_u32(header + 4), TELEMETRY_VERSION);
+        fclose(reader->file);
+        return false;
+    }
+    return true;
+}
+
+// Read one column of a block into reader->data. Returns its length or -1.
+long read_column(struct TelemetryReader *reader) {
+    unsigned char header[4];
+
+    if (fread(header, 1, 4, reader->file) != 4) {
+        return -1;
+    }
+    uint32_t len = get_u32(header);
+    if (len > COLUMN_CAP) {
+        return -1;
+    }
+    if (len > reader->data_cap) {
+        unsigned char *bigger = realloc(reader->data, len);
+        if (bigger == NULL) {
+            return -1;
+        }
+        reader->data = bigger;
+        reader->data_cap = len;
+    }
+    if (fread(reader->data, 1, len, reader->file) != len) {
+        return -1;
+    }
+    return (long)len;
+}
+
+int telemetry_reader_next(struct TelemetryReader *reader, struct TelemetryEvent *events) {
+    unsigned char header[4];
+    size_t got = fread(header, 1, 4, reader->file);
+    int i, c;
+
+    if (got == 0) {
+        return 0;
+    }
+    uint32_t count = get_u32(header);
+    if (got != 4 || count == 0 || count > TELEMETRY_BLOCK_EVENTS) {
+        return -1;
+    }
+
+    memset(events, 0, count * sizeof(struct TelemetryEvent));
+    for (c = 0; c < TELEMETRY_COLUMNS; c++) {
+        long len = read_column(reader);
+        if (len < 0) {
+            return -1;
+        }
+        const unsigned char *p = reader->data;
+        const unsigned char *end = p + len;
+
+        if (c == 2 || c == 5 || c == 6) {
+            // One byte per event
+            if (len != (long)count) {
+                return -1;
+            }
+            for (i = 0; i < (int)count; i++) {
+                if (c == 2) events[i].type = p[i];
+                else if (c == 5) events[i].ghost = p[i];
+                else events[i].dir = p[i];
+            }
+            continue;
+        }
+
+        uint32_t value = 0;
+        for (i = 0; i < (int)count; i++) {
+            p = get_delta(p, end, &value);
+            if (p == NULL) {
+                return -1;
+            }
+            if (c == 0) events[i].tick = value;
+            else if (c == 1) events[i].session = value;
+            else if (c == 3) events[i].row = (uint16_t)value;
+            else events[i].col = (uint16_t)value;
+        }
+        if (p != end) {
+            return -1;
+        }
+    }
+    return (int)count;
+}
+
+void telemetry_reader_close(struct TelemetryReader *reader) {
+    if (reader->file != NULL) {
+        fclose(reader->file);
+    }
+    free(reader->data);
+    memset(reader, 0, sizeof(*reader));
+}
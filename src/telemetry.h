@@ -0,0 +1,143 @@
+/*
+ * Gameplay telemetry.
+ *
+ * Logs every dot eaten, life lost, ghost move and win or loss, with the
+ * session, tick and position, for offline analysis. Each thread that
+ * plays games attaches once and then writes fixed-size event records
+ * into its own lock-free ring; nothing is shared between game threads
+ * and a thread that hasn't attached pays one branch per event. A
+ * background thread drains the rings and writes them to disk. If it
+ * can't keep up, events are dropped and counted rather than waited on.
+ *
+ * The file is columnar so it compresses well and a reader can skip the
+ * fields it doesn't want:
+ *
+ *   file:   "PMTL", uint32 version, then blocks until the end of the file
+ *   block:  uint32 event count, then one column per field in the order
+ *           tick, session, type, row, col, ghost, dir. Each column is a
+ *           uint32 byte length followed by the data.
+ *
+ * tick, session, row and col are stored as the difference from the
+ * previous event in the block (the first from 0), zigzag encoded so
+ * small negative steps stay small, as LEB128 varints. type, ghost and
+ * dir are one byte per event. All integers are little-endian.
+ *
+ * `pacman_telemetry` turns a log into CSV.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "atomics.h"
+
+#define TELEMETRY_DOT 0          // Pac-man ate the dot at row/col
+#define TELEMETRY_LIFE_LOST 1    // Pac-man was caught at row/col by `ghost`
+#define TELEMETRY_GHOST_MOVE 2   // Ghost `ghost` chose `dir` and is now at row/col
+#define TELEMETRY_WIN 3          // Last dot eaten
+#define TELEMETRY_GAME_OVER 4    // Last life lost (after its TELEMETRY_LIFE_LOST)
+#define TELEMETRY_GHOST_CHEAP_MOVE 5  // Like TELEMETRY_GHOST_MOVE, but a cheap decision (AI_DETAIL_*)
+#define TELEMETRY_EVENT_TYPES 6
+
+#define TELEMETRY_NONE 0xff      // No ghost / no direction
+
+// Events each thread can get ahead of the disk writer (a power of two)
+#define TELEMETRY_RING_EVENTS (64 * 1024)
+
+// Most events in one block of the file
+#define TELEMETRY_BLOCK_EVENTS 8192
+
+// Most threads that can attach
+#define TELEMETRY_MAX_THREADS 256
+
+struct TelemetryEvent {
+    uint32_t tick;      // Session tick (APP_TICK_MS each)
+    uint32_t session;
+    uint16_t row;
+    uint16_t col;
+    uint8_t type;       // TELEMETRY_*
+    uint8_t ghost;      // Ghost type or TELEMETRY_NONE
+    uint8_t dir;        // GHOST_DIR_* or TELEMETRY_NONE
+    uint8_t unused;
+};
+
+// One thread's events on their way to the writer
+struct TelemetryBuffer {
+    struct TelemetryEvent *events;
+    _Alignas(64) volatile uint64_t head;  // Read position (writer thread)
+    _Alignas(64) volatile uint64_t tail;  // Write position (owner thread)
+    uint64_t limit;                       // Owner thread: tail can go up to here without checking head
+    uint64_t dropped;                     // Owner thread only
+    volatile int ready;                   // Set once the writer may read it
+};
+
+struct TelemetryStats {
+    uint64_t events;         // Events that made it into the file
+    uint64_t dropped;        // Events lost because the writer fell behind
+    uint64_t file_bytes;
+};
+
+#if defined(_MSC_VER)
+#define TELEMETRY_THREAD_LOCAL __declspec(thread)
+#else
+#define TELEMETRY_THREAD_LOCAL _Thread_local
+#endif
+
+// This thread's buffer, or NULL if it isn't logging
+extern TELEMETRY_THREAD_LOCAL struct TelemetryBuffer *t_telemetry;
+
+// Start logging to `path`
+bool telemetry_start(const char *path);
+
+// Log events from the calling thread from now on. Does nothing if
+// telemetry wasn't started.
+void telemetry_attach();
+
+// Finish writing and close the file. Every attached thread must be done.
+void telemetry_stop(struct TelemetryStats *stats);
+
+// The ring looked full: see how far the writer has got
+bool telemetry_make_room(struct TelemetryBuffer *buf);
+
+static inline void telemetry_record(int type, uint32_t session, uint32_t tick,
+                                    int row, int col, int ghost, int dir) {
+    struct TelemetryBuffer *buf = t_telemetry;
+    if (buf == NULL) {
+        return;
+    }
+    uint64_t tail = buf->tail;
+    if (tail == buf->limit && telemetry_make_room(buf) == false) {
+        return;
+    }
+    struct TelemetryEvent *event = &buf->events[tail & (TELEMETRY_RING_EVENTS - 1)];
+    event->tick = tick;
+    event->session = session;
+    event->row = (uint16_t)row;
+    event->col = (uint16_t)col;
+    event->type = (uint8_t)type;
+    event->ghost = (uint8_t)ghost;
+    event->dir = (uint8_t)dir;
+    event->unused = 0;
+    atom_store64(&buf->tail, tail + 1);
+}
+
+// Reading a log back, a block at a time
+struct TelemetryReader {
+    FILE *file;
+    unsigned char *data;
+    size_t data_cap;
+};
+
+bool telemetry_reader_open(struct TelemetryReader *reader, const char *path);
+
+// Read the next block into `events` (TELEMETRY_BLOCK_EVENTS long).
+// Returns the number of events, 0 at the end of the file or -1 if the
+// file is damaged.
+int telemetry_reader_next(struct TelemetryReader *reader, struct TelemetryEvent *events);
+
+void telemetry_reader_close(struct TelemetryReader *reader);
+
+// Names for CSV output
+const char *telemetry_type_name(int type);
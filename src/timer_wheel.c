@@ -0,0 +1,110 @@
+#include "timer_wheel.h"
+
+#include <string.h>
+
+// Empty link
+#define TIMER_NONE 0xff
+
+void timer_wheel_init(struct TimerWheel *wheel) {
+    memset(wheel, TIMER_NONE, sizeof(*wheel));
+    wheel->now = 0;
+}
+
+bool timer_wheel_pending(const struct TimerWheel *wheel, int id) {
+    return wheel->where[id] != TIMER_NONE;
+}
+
+// Take a timer out of its slot
+void timer_unlink(struct TimerWheel *wheel, int id) {
+    int level = wheel->where[id] / TIMER_WHEEL_SLOTS;
+    int slot = wheel->where[id] % TIMER_WHEEL_SLOTS;
+    uint8_t next = wheel->next[id];
+    uint8_t prev = wheel->prev[id];
+
+    if (prev == TIMER_NONE) {
+        wheel->heads[level][slot] = next;
+    } else {
+        wheel->next[prev] = next;
+    }
+    if (next != TIMER_NONE) {
+        wheel->prev[next] = prev;
+    }
+    wheel->where[id] = TIMER_NONE;
+}
+
+// Put a timer in the slot for its deadline: the lowest level that
+// reaches that far. Further than the wheel reaches, it waits in the top
+// level's last slot and is looked at again when that slot comes round.
+void timer_link(struct TimerWheel *wheel, int id) {
+    uint32_t delta = wheel->due[id] - wheel->now;
+    int level = 0;
+    uint32_t slot_tick = wheel->due[id];
+
+    while (level < TIMER_WHEEL_LEVELS - 1 && delta >= (1u << (TIMER_WHEEL_BITS * (level + 1)))) {
+        level = level + 1;
+    }
+    if (delta >= (1u << (TIMER_WHEEL_BITS * TIMER_WHEEL_LEVELS))) {
+        slot_tick = wheel->now + ((uint32_t)(TIMER_WHEEL_SLOTS - 1) << (TIMER_WHEEL_BITS * level));
+    }
+
+    int slot = (int)(slot_tick >> (TIMER_WHEEL_BITS * level)) & (TIMER_WHEEL_SLOTS - 1);
+    uint8_t head = wheel->heads[level][slot];
+    wheel->next[id] = head;
+    wheel->prev[id] = TIMER_NONE;
+    if (head != TIMER_NONE) {
+        wheel->prev[head] = (uint8_t)id;
+    }
+    wheel->heads[level][slot] = (uint8_t)id;
+    wheel->where[id] = (uint8_t)(level * TIMER_WHEEL_SLOTS + slot);
+}
+
+void timer_wheel_schedule(struct TimerWheel *wheel, int id, uint32_t delay) {
+    if (timer_wheel_pending(wheel, id)) {
+        timer_unlink(wheel, id);
+    }
+    wheel->due[id] = wheel->now + (delay > 0 ? delay : 1);
+    timer_link(wheel, id);
+}
+
+void timer_wheel_cancel(struct TimerWheel *wheel, int id) {
+    if (timer_wheel_pending(wheel, id)) {
+        timer_unlink(wheel, id);
+    }
+}
+
+// A higher level slot's turn has come: spread its timers over the levels
+// below
+void timer_cascade(struct TimerWheel *wheel, int level) {
+    int slot = (int)(wheel->now >> (TIMER_WHEEL_BITS * level)) & (TIMER_WHEEL_SLOTS - 1);
+
+    while (wheel->heads[level][slot] != TIMER_NONE) {
+        int id = wheel->heads[level][slot];
+        timer_unlink(wheel, id);
+        timer_link(wheel, id);
+    }
+}
+
+uint32_t timer_wheel_advance(struct TimerWheel *wheel) {
+    uint32_t fired = 0;
+    int level;
+
+    wheel->now = wheel->now + 1;
+
+    // Top level first, so its timers can land in a lower slot that is
+    // due this same tick
+    int slot = (int)(wheel->now & (TIMER_WHEEL_SLOTS - 1));
+    if (slot == 0) {
+        for (level = TIMER_WHEEL_LEVELS - 1; level > 0; level--) {
+            if ((wheel->now & ((1u << (TIMER_WHEEL_BITS * level)) - 1)) == 0) {
+                timer_cascade(wheel, level);
+            }
+        }
+    }
+
+    while (wheel->heads[0][slot] != TIMER_NONE) {
+        int id = wheel->heads[0][slot];
+        timer_unlink(wheel, id);
+        fired = fired | (1u << id);
+    }
+    return fired;
+}
@@ -0,0 +1,49 @@
+/*
+ * Hierarchical timer wheel.
+ *
+ * Schedules a small fixed set of timers (pac-man, each ghost, game
+ * events) in whole ticks. Each level is a ring of slots and each slot is
+ * a linked list of the timers due in it. Timers close to their deadline
+ * sit in level 0, one tick per slot. Timers further away sit in a higher
+ * level, where each slot covers a whole turn of the level below, and move
+ * down when that turn comes round. Moving the wheel on a tick only looks
+ * at the one slot that is due, so it costs the same however many timers
+ * are waiting.
+ *
+ * Links are indexes, not pointers, so a wheel can be copied with memcpy
+ * along with the rest of a session.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define TIMER_WHEEL_MAX 8          // Timers per wheel (ids 0 to 7)
+#define TIMER_WHEEL_BITS 4
+#define TIMER_WHEEL_SLOTS (1 << TIMER_WHEEL_BITS)
+#define TIMER_WHEEL_LEVELS 3       // 16, 256 and 4096 ticks ahead
+
+struct TimerWheel {
+    uint32_t now;                                         // Ticks so far
+    uint8_t heads[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS]; // First timer in each slot
+    uint8_t next[TIMER_WHEEL_MAX];
+    uint8_t prev[TIMER_WHEEL_MAX];
+    uint8_t where[TIMER_WHEEL_MAX];                       // level * SLOTS + slot
+    uint32_t due[TIMER_WHEEL_MAX];                        // Tick the timer fires on
+};
+
+// Start with no timers at tick 0
+void timer_wheel_init(struct TimerWheel *wheel);
+
+// Fire timer `id` in `delay` ticks (at least 1). A pending timer is moved.
+void timer_wheel_schedule(struct TimerWheel *wheel, int id, uint32_t delay);
+
+// Stop timer `id` if it is pending
+void timer_wheel_cancel(struct TimerWheel *wheel, int id);
+
+bool timer_wheel_pending(const struct TimerWheel *wheel, int id);
+
+// Move on one tick. Returns a bit per timer that fired (bit `id`); those
+// timers are no longer pending.
+uint32_t timer_wheel_advance(struct TimerWheel *wheel);
@@ -0,0 +1,48 @@
+#include "triple_buffer.h"
+#include "atomics.h"
+#include "platform.h"
+
+#include <string.h>
+
+bool triple_buffer_create(struct TripleBuffer *tb, const struct Level *level) {
+    size_t stride = app_session_size(level);
+    int i;
+
+    tb->memory = platform_aligned_alloc(CACHE_LINE_SIZE, stride * 3);
+    if (tb->memory == NULL) {
+        return false;
+    }
+    for (i = 0; i < 3; i++) {
+        tb->slots[i] = (struct App *)(tb->memory + stride * (size_t)i);
+        app_init(tb->slots[i], level, APP_HEADLESS);
+    }
+    tb->back = 0;
+    tb->middle = 1;
+    tb->front = 2;
+    return true;
+}
+
+void triple_buffer_destroy(struct TripleBuffer *tb) {
+    platform_aligned_free(tb->memory);
+    tb->memory = NULL;
+}
+
+void triple_buffer_publish(struct TripleBuffer *tb, const struct App *app) {
+    struct App *slot = tb->slots[tb->back];
+
+    // The session and its dots are one block, so one copy does it
+    memcpy(slot, app, app_session_size(app->level));
+
+    // Swap the filled slot into the middle and take whatever was there
+    int old = atom_exchange(&tb->middle, tb->back | TRIPLE_BUFFER_FRESH);
+    tb->back = old & 3;
+}
+
+bool triple_buffer_acquire(struct TripleBuffer *tb) {
+    if ((atom_load(&tb->middle) & TRIPLE_BUFFER_FRESH) == 0) {
+        return false;
+    }
+    int old = atom_exchange(&tb->middle, tb->front);
+    tb->front = old & 3;
+    return true;
+}
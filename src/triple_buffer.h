@@ -0,0 +1,40 @@
+/*
+ * Triple buffer of game snapshots.
+ *
+ * The simulation thread writes a copy of the game into a spare slot and
+ * publishes it; the render thread always picks up the newest published
+ * copy. Neither side ever waits for the other: if the renderer is slow,
+ * older snapshots are simply overwritten.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+
+#include "app.h"
+
+#define TRIPLE_BUFFER_FRESH 4  // Set in `middle` when it holds an unread snapshot
+
+struct TripleBuffer {
+    struct App *slots[3];
+    int back;                  // Slot the writer fills next (writer only)
+    int front;                 // Slot the reader is looking at (reader only)
+    _Alignas(CACHE_LINE_SIZE) volatile int middle;  // Slot waiting to be read, plus the FRESH bit
+    unsigned char *memory;
+};
+
+// Make three snapshot slots big enough for sessions of `level`
+bool triple_buffer_create(struct TripleBuffer *tb, const struct Level *level);
+
+void triple_buffer_destroy(struct TripleBuffer *tb);
+
+// Writer: copy the game into the back slot and make it the newest snapshot
+void triple_buffer_publish(struct TripleBuffer *tb, const struct App *app);
+
+// Reader: switch to the newest snapshot; returns false if nothing new came in
+bool triple_buffer_acquire(struct TripleBuffer *tb);
+
+// Reader: the snapshot picked by the last triple_buffer_acquire
+static inline const struct App *triple_buffer_front(const struct TripleBuffer *tb) {
+    return tb->slots[tb->front];
+}
@@ -0,0 +1,156 @@
+/*
+ * Session benchmark.
+ *
+ * Keeps a lot of headless games in memory at once and ticks all of them,
+ * to see how much memory a session costs and how fast we can simulate.
+ * Then it times restarts: every round each session makes a move and is
+ * restarted, as when a bot is trained on short games.
+ *
+ * Usage: pacman_bench [sessions] [ticks] [ROWSxCOLS]
+ *
+ * Give a maze size to play on a generated maze instead of the built-in
+ * one, e.g. `pacman_bench 1000 20 1023x1023`.
+ *
+ * Set PACMAN_TELEMETRY to a file name to log gameplay telemetry while
+ * benchmarking, to see what it costs, and PACMAN_AI_DETAIL (full,
+ * fixed:N or timed:US) to try a ghost AI level of detail.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "app.h"
+#include "platform.h"
+#include "session_pool.h"
+#include "telemetry.h"
+
+// Give every session a move and `ticks` game ticks. The sessions go
+// through a group at a time, so each group stays in cache for all its
+// ticks, and a group's ghosts are scored together (app_tick_many).
+void play_round(struct App **apps, int sessions, int round, int ticks, bool restart_finished) {
+    int first, i, k;
+    for (first = 0; first < sessions; first = first + APP_TICK_GROUP) {
+        int group = sessions - first < APP_TICK_GROUP ? sessions - first : APP_TICK_GROUP;
+        for (i = first; i < first + group; i++) {
+            app_handle_input(apps[i], "wasd"[(i + round) & 3]);
+        }
+        for (k = 0; k < ticks; k++) {
+            app_tick_many(apps + first, group);
+        }
+        for (i = first; i < first + group && restart_finished; i++) {
+            if (apps[i]->game_over || apps[i]->won) {
+                app_handle_input(apps[i], 'r');
+            }
+        }
+    }
+}
+
+int main(int argc, char **argv) {
+    int sessions = 100000;
+    int ticks = 20;
+    int maze_rows = 0, maze_cols = 0;
+    int i, t;
+
+    if (argc > 1) sessions = atoi(argv[1]);
+    if (argc > 2) ticks = atoi(argv[2]);
+    if (argc > 3 && sscanf(argv[3], "%dx%d", &maze_rows, &maze_cols) != 2) sessions = 0;
+    if (sessions <= 0 || ticks <= 0) {
+        fprintf(stderr, "Usage: %s [sessions] [ticks] [ROWSxCOLS]\n", argv[0]);
+        return 1;
+    }
+
+    const struct Level *level = level_default();
+    struct Level maze;
+    if (maze_rows > 0) {
+        long long generate_start = platform_time_us();
+        if (level_generate(&maze, maze_rows, maze_cols, 1) == false) {
+            fprintf(stderr, "Error: maze size must be %dx%d to %dx%d\n",
+                    LEVEL_MIN_SIZE, LEVEL_MIN_SIZE, LEVEL_MAX_SIZE, LEVEL_MAX_SIZE);
+            return 1;
+        }
+        printf("maze %dx%d generated: %.2f ms\n", maze_rows, maze_cols,
+               (double)(platform_time_us() - generate_start) / 1e3);
+        level = &maze;
+    }
+    struct SessionPool pool;
+    if (session_pool_create(&pool, level, sessions) == false) {
+        fprintf(stderr, "Error: out of memory\n");
+        return 1;
+    }
+
+    const char *telemetry_path = getenv("PACMAN_TELEMETRY");
+    if (telemetry_path != NULL) {
+        if (telemetry_start(telemetry_path) == false) {
+            return 1;
+        }
+        telemetry_attach();
+    }
+
+    static struct GhostParams params;
+    const char *detail = getenv("PACMAN_AI_DETAIL");
+    params = GHOST_PARAMS_DEFAULT;
+    if (detail != NULL && ghost_params_parse_detail(&params, detail) == false) {
+        fprintf(stderr, "Error: PACMAN_AI_DETAIL must be full, fixed:N or timed:US\n");
+        return 1;
+    }
+
+    struct App **apps = malloc((size_t)sessions * sizeof(struct App *));
+    for (i = 0; i < sessions; i++) {
+        apps[i] = session_pool_acquire(&pool, APP_HEADLESS);
+        app_set_params(apps[i], &params);
+        app_seed(apps[i], (uint32_t)i);
+    }
+
+    // Each round every session gets one move and one ghost move's worth
+    // of game ticks
+    int ticks_per_move = GAME_TICK_MS / APP_TICK_MS;
+    long long start = platform_time_us();
+    for (t = 0; t < ticks; t++) {
+        play_round(apps, sessions, t, ticks_per_move, true);
+    }
+    long long elapsed = platform_time_us() - start;
+    if (elapsed <= 0) elapsed = 1;
+
+    // Only the restarts are timed
+    long long restart_time = 0;
+    for (t = 0; t < ticks; t++) {
+        play_round(apps, sessions, t, ticks_per_move, false);
+        long long restart_start = platform_time_ns();
+        for (i = 0; i < sessions; i++) {
+            app_handle_input(apps[i], 'r');
+        }
+        restart_time = restart_time + platform_time_ns() - restart_start;
+    }
+    if (restart_time <= 0) restart_time = 1;
+
+    printf("sizeof(struct App):   %zu bytes\n", sizeof(struct App));
+    printf("memory per session:   %zu bytes\n", pool.stride);
+    printf("resident sessions:    %d (%.1f MB)\n", sessions, (double)pool.stride * sessions / 1e6);
+    printf("session ticks/second: %.0f\n", (double)sessions * ticks * 1e6 / (double)elapsed);
+    printf("restarts/second:      %.0f\n", (double)sessions * ticks * 1e9 / (double)restart_time);
+
+    if (params.detail != AI_DETAIL_FULL) {
+        unsigned long long full = 0, cheap = 0;
+        for (i = 0; i < sessions; i++) {
+            full = full + apps[i]->ai_full;
+            cheap = cheap + apps[i]->ai_cheap;
+        }
+        printf("ghost decisions:      %llu proper, %llu cheap (%.1f%%)\n", full, cheap,
+               100.0 * (double)cheap / (double)(full + cheap > 0 ? full + cheap : 1));
+    }
+
+    if (telemetry_path != NULL) {
+        struct TelemetryStats stats;
+        telemetry_stop(&stats);
+        printf("telemetry events:     %llu (%llu dropped, %.1f bytes each on disk)\n",
+               (unsigned long long)stats.events, (unsigned long long)stats.dropped,
+               (double)stats.file_bytes / (double)(stats.events > 0 ? stats.events : 1));
+    }
+
+    free(apps);
+    session_pool_destroy(&pool);
+    if (level != level_default()) {
+        level_free(&maze);
+    }
+    return 0;
+}
@@ -0,0 +1,321 @@
+/*
+ * Check the ghost AI against the plain C versions of it.
+ *
+ * First it fills batches with random ghosts and scores each one with
+ * both ghost_kernel_score and ghost_kernel_score_scalar. The positions
+ * are kept close to their targets so ties are common, every direction
+ * mask (including none) comes up, and the batch sizes run from 0 to
+ * GHOST_BATCH_MAX so the leftovers the SIMD loop hands to the scalar
+ * code are covered too.
+ *
+ * Then it puts ghosts and pac-man in random places in real mazes, moves
+ * the ghosts of APP_TICK_GROUP sessions in one plan, as app_tick_many
+ * does, and checks every move against the original one-ghost-at-a-time
+ * logic for each ghost type, written out again below. A mistake shared
+ * by the kernel and its scalar version can't get past that.
+ *
+ * Anything that differs is printed and the check fails. Run by ctest.
+ *
+ * Usage: pacman_kernel_check [options]
+ *   --batches N      Batches to check   (default 100000)
+ *   --seed N         Random seed        (default 1)
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "app.h"
+#include "ghost_kernel.h"
+#include "level.h"
+
+// Stop printing after this many differences
+#define MAX_REPORTED 10
+
+void print_usage(const char *program) {
+    fprintf(stderr, "Usage: %s [--batches N] [--seed N]\n", program);
+}
+
+unsigned int next_random(unsigned int *state) {
+    unsigned int x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+// Mostly small distances so several directions tie; now and then a far
+// away target like the ones scatter mode uses
+void fill_batch(struct GhostBatch *batch, int count, unsigned int *rng) {
+    int i;
+    batch->count = count;
+    for (i = 0; i < GHOST_BATCH_MAX; i++) {
+        int spread = next_random(rng) % 8 == 0 ? 2000 : 4;
+        batch->row[i] = (int)(next_random(rng) % 200);
+        batch->col[i] = (int)(next_random(rng) % 200);
+        batch->target_row[i] = batch->row[i] + (int)(next_random(rng) % (2 * spread + 1)) - spread;
+        batch->target_col[i] = batch->col[i] + (int)(next_random(rng) % (2 * spread + 1)) - spread;
+        batch->dir_mask[i] = (int)(next_random(rng) % 16);
+        batch->chosen[i] = -2;
+    }
+}
+
+unsigned int random_below(unsigned int *state, int n) {
+    return next_random(state) % (unsigned int)n;
+}
+
+// Any cell that isn't a wall
+struct Position random_cell(const struct Level *level, unsigned int *rng) {
+    struct Position pos;
+    do {
+        pos.row = (int)random_below(rng, level->rows);
+        pos.col = (int)random_below(rng, level->cols);
+    } while (level_is_wall(level, pos.row, pos.col));
+    return pos;
+}
+
+int distance(int row, int col, int target_row, int target_col) {
+    return abs(row - target_row) + abs(col - target_col);
+}
+
+// Nearest of `dirs` (in order) to the target; the first one wins ties
+int nearest_dir(const struct Ghost *ghost, const int *dirs, int count, int target_row, int target_col) {
+    int best_dist = 1 << 30;
+    int chosen = -1;
+    int i;
+    for (i = 0; i < count; i++) {
+        int d = dirs[i];
+        int dist = distance(ghost->pos.row + GHOST_DIR_ROW[d], ghost->pos.col + GHOST_DIR_COL[d],
+                            target_row, target_col);
+        if (dist < best_dist) {
+            best_dist = dist;
+            chosen = d;
+        }
+    }
+    return chosen;
+}
+
+int clamp(int value, int low, int high) {
+    return value < low ? low : value > high ? high : value;
+}
+
+// The game's ghost AI as it was before the batched kernel: each ghost
+// type with its own rules, the default tuning written in. `rng` is the
+// session's random state, drawn from in the same order as the game.
+int reference_move(const struct App *app, const struct Ghost *ghost, uint32_t *rng) {
+    const struct Level *level = app->level;
+    int valid[4], filtered[4];
+    int valid_count = 0, filtered_count = 0;
+    int i;
+
+    for (i = 0; i < 4; i++) {
+        int nr = ghost->pos.row + GHOST_DIR_ROW[i];
+        int nc = ghost->pos.col + GHOST_DIR_COL[i];
+        if (nr >= 0 && nr < level->rows && nc >= 0 && nc < level->cols && level_is_wall(level, nr, nc) == false) {
+            valid[valid_count] = i;
+            valid_count = valid_count + 1;
+        }
+    }
+    if (valid_count == 0) {
+        return -1;
+    }
+
+    // Try not to go backwards
+    int opposite = ghost->last_dir < 0 ? -1 : ghost->last_dir ^ 1;
+    for (i = 0; i < valid_count; i++) {
+        if (valid[i] != opposite || valid_count == 1) {
+            filtered[filtered_count] = valid[i];
+            filtered_count = filtered_count + 1;
+        }
+    }
+
+    int target_row = app->pacman.row;
+    int target_col = app->pacman.col;
+
+    if (ghost->type == GHOST_CHASER) {
+        return nearest_dir(ghost, filtered, filtered_count, target_row, target_col);
+    }
+    if (ghost->type == GHOST_AMBUSHER) {
+        // Four tiles ahead of pac-man
+        int aim_r = clamp(target_row + 4 * GHOST_DIR_ROW[app->pacman_dir], 0, level->rows - 1);
+        int aim_c = clamp(target_col + 4 * GHOST_DIR_COL[app->pacman_dir], 0, level->cols - 1);
+        return nearest_dir(ghost, filtered, filtered_count, aim_r, aim_c);
+    }
+    if (ghost->type == GHOST_FLANKER) {
+        // Three tiles to the side pac-man isn't moving along
+        int flank_r = target_row;
+        int flank_c = target_col;
+        if (app->pacman_dir == 0 || app->pacman_dir == 1) {
+            flank_c = ghost->pos.col > target_col ? flank_c + 3 : flank_c - 3;
+        } else {
+            flank_r = ghost->pos.row > target_row ? flank_r + 3 : flank_r - 3;
+        }
+        flank_r = clamp(flank_r, 0, level->rows - 1);
+        flank_c = clamp(flank_c, 0, level->cols - 1);
+        return nearest_dir(ghost, filtered, filtered_count, flank_r, flank_c);
+    }
+
+    // Orange: chases 30% of the time, otherwise picks at random
+    if (next_random(rng) % 100 < 30) {
+        return nearest_dir(ghost, filtered, filtered_count, target_row, target_col);
+    }
+    return filtered[next_random(rng) % (uint32_t)filtered_count];
+}
+
+// Put pac-man and the ghosts somewhere random, facing any way
+void scatter_session(struct App *app, unsigned int *rng) {
+    int g;
+    app_restart(app);
+    app_seed(app, next_random(rng));
+    app->pacman = random_cell(app->level, rng);
+    app->pacman_dir = (int)random_below(rng, 4);
+    for (g = 0; g < NUM_GHOSTS; g++) {
+        app->ghosts[g].pos = random_cell(app->level, rng);
+        app->ghosts[g].last_dir = (int)random_below(rng, 5) - 1;
+    }
+}
+
+// Move the ghosts of a group of sessions through the game's batched path
+// and compare with reference_move. Returns the number of ghosts checked.
+long check_group(struct App **apps, int count, unsigned int *rng, long batch, long *differences) {
+    struct GhostPlan plan;
+    int expected[APP_TICK_GROUP][NUM_GHOSTS];
+    uint32_t all = ((1u << NUM_GHOSTS) - 1) << TIMER_GHOST;
+    int i, g;
+
+    plan.batch.count = 0;
+    for (i = 0; i < count; i++) {
+        scatter_session(apps[i], rng);
+        uint32_t session_rng = apps[i]->rng;
+        for (g = 0; g < NUM_GHOSTS; g++) {
+            expected[i][g] = reference_move(apps[i], &apps[i]->ghosts[g], &session_rng);
+        }
+        app_plan_ghosts(&plan, apps[i], all);
+    }
+
+    // Where each ghost was, to work out which way it went
+    struct Position before[APP_TICK_GROUP][NUM_GHOSTS];
+    for (i = 0; i < count; i++) {
+        for (g = 0; g < NUM_GHOSTS; g++) {
+            before[i][g] = apps[i]->ghosts[g].pos;
+        }
+    }
+    app_move_planned_ghosts(&plan);
+
+    for (i = 0; i < count; i++) {
+        for (g = 0; g < NUM_GHOSTS; g++) {
+            const struct Ghost *ghost = &apps[i]->ghosts[g];
+            int moved = -1, d;
+            for (d = 0; d < 4; d++) {
+                if (ghost->pos.row == before[i][g].row + GHOST_DIR_ROW[d] &&
+                    ghost->pos.col == before[i][g].col + GHOST_DIR_COL[d]) {
+                    moved = d;
+                }
+            }
+            if (moved != expected[i][g]) {
+                if (*differences < MAX_REPORTED) {
+                    printf("group %ld session %d ghost %d (type %d) at %d,%d, pac-man %d,%d facing %d: "
+                           "moved %d, original rules say %d\n",
+                           batch, i, g, ghost->type, before[i][g].row, before[i][g].col,
+                           apps[i]->pacman.row, apps[i]->pacman.col, apps[i]->pacman_dir, moved, expected[i][g]);
+                }
+                *differences = *differences + 1;
+            }
+        }
+    }
+    return (long)count * NUM_GHOSTS;
+}
+
+int main(int argc, char **argv) {
+    long batches = 100000;
+    unsigned int seed = 1;
+    struct GhostBatch simd, scalar;
+    long b, ghosts = 0, differences = 0;
+    int i;
+
+    for (i = 1; i < argc; i++) {
+        const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+        bool ok = true;
+        if (strcmp(argv[i], "--batches") == 0 && value != NULL) {
+            batches = atol(value);
+            ok = batches > 0;
+            i = i + 1;
+        } else if (strcmp(argv[i], "--seed") == 0 && value != NULL) {
+            seed = (unsigned int)strtoul(value, NULL, 10);
+            ok = seed != 0;
+            i = i + 1;
+        } else {
+            ok = false;
+        }
+        if (ok == false) {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    unsigned int rng = seed;
+    for (b = 0; b < batches; b++) {
+        fill_batch(&simd, (int)(b % (GHOST_BATCH_MAX + 1)), &rng);
+        scalar = simd;
+        ghost_kernel_score(&simd);
+        ghost_kernel_score_scalar(&scalar, 0);
+
+        for (i = 0; i < simd.count; i++) {
+            if (simd.chosen[i] != scalar.chosen[i]) {
+                if (differences < MAX_REPORTED) {
+                    printf("batch %ld ghost %d: at %d,%d target %d,%d mask %d: %s chose %d, scalar chose %d\n",
+                           b, i, simd.row[i], simd.col[i], simd.target_row[i], simd.target_col[i],
+                           simd.dir_mask[i], ghost_kernel_name(), simd.chosen[i], scalar.chosen[i]);
+                }
+                differences = differences + 1;
+            }
+        }
+        ghosts = ghosts + simd.count;
+    }
+
+    printf("%s kernel: %ld ghosts in %ld batches, %ld differ from scalar\n",
+           ghost_kernel_name(), ghosts, batches, differences);
+
+    // The built-in maze, and a generated one with more junctions
+    struct Level maze;
+    const struct Level *levels[2];
+    struct App *apps[2][APP_TICK_GROUP];
+    long moves = 0, wrong = 0;
+    int l;
+
+    if (level_generate(&maze, 41, 81, seed) == false) {
+        fprintf(stderr, "Error: out of memory\n");
+        return 1;
+    }
+    levels[0] = level_default();
+    levels[1] = &maze;
+    for (l = 0; l < 2; l++) {
+        for (i = 0; i < APP_TICK_GROUP; i++) {
+            apps[l][i] = app_create(levels[l]);
+            if (apps[l][i] == NULL) {
+                fprintf(stderr, "Error: out of memory\n");
+                return 1;
+            }
+            apps[l][i]->flags = APP_HEADLESS;
+        }
+    }
+
+    for (b = 0; b < batches / 4; b++) {
+        // Groups of every size, so partly filled batches come up too
+        int count = 1 + (int)(b % APP_TICK_GROUP);
+        moves = moves + check_group(apps[b & 1], count, &rng, b, &wrong);
+    }
+
+    printf("%s kernel: %ld ghost moves in %ld groups of sessions, %ld differ from the original rules\n",
+           ghost_kernel_name(), moves, batches / 4, wrong);
+
+    for (l = 0; l < 2; l++) {
+        for (i = 0; i < APP_TICK_GROUP; i++) {
+            app_destroy(apps[l][i]);
+        }
+    }
+    level_free(&maze);
+    return differences == 0 && wrong == 0 ? 0 : 1;
+}
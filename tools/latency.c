@@ -0,0 +1,533 @@
+/*
+ * Keypress-to-screen latency harness (macOS and Linux).
+ *
+ * Runs the game in a pseudo-terminal, presses movement keys at random
+ * moments and reads everything the game draws through a small terminal
+ * emulator. A sample is the time from writing a key to the moment the
+ * bold yellow `C` shows up on the cell next to where pac-man was. Only
+ * keys towards an open tile are pressed, so every sample should land;
+ * samples where pac-man ends up somewhere else (caught by a ghost) or
+ * never moves are thrown away. The maze has to fit on the terminal: when
+ * the view scrolls, pac-man stays put on screen. The game is run with
+ * 16 colours, since that's how pac-man is recognised; `-- --render rep`
+ * or `-- --render unicode` time the other encodings.
+ *
+ * Needs no display, so it runs in CI.
+ *
+ * Usage: pacman_latency [options] [-- GAME ARGS...]
+ *   --game PATH        Game to run                     (default: pacman next to this tool)
+ *   --samples N        Keypresses to time              (default 200)
+ *   --size ROWSxCOLS   Terminal size                   (default 40x120)
+ *   --max-p50 MS       Fail if the median is slower than this
+ */
+
+// posix_openpt and friends are hidden on glibc without this
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/wait.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "platform.h"
+
+#define MAX_TERM_ROWS 200
+#define MAX_TERM_COLS 400
+#define MAX_PARAMS 16
+
+// Give up on a key if pac-man hasn't moved by then
+#define SAMPLE_TIMEOUT_MS 1000
+
+// Time between keys, picked at random so keys land anywhere in a tick
+#define MIN_GAP_MS 40
+#define MAX_GAP_MS 120
+
+struct Cell {
+    char ch;
+    unsigned char fg;       // 30-37, or 0 for the default
+    bool bold;
+};
+
+// Just enough of a VT100 for what the game sends
+struct Terminal {
+    int rows, cols;
+    int row, col;
+    unsigned char fg;
+    bool bold;
+    char last_ch;           // Last character printed, for REP
+
+    int state;              // 0 = text, 1 = after ESC, 2 = in a CSI sequence
+    int params[MAX_PARAMS];
+    int param_count;
+    bool private_mode;      // CSI ? ...
+    struct Cell cells[MAX_TERM_ROWS][MAX_TERM_COLS];
+};
+
+void term_clear(struct Terminal *term, int from_row, int from_col, int to_row, int to_col) {
+    int r, c;
+    for (r = from_row; r <= to_row; r++) {
+        for (c = (r == from_row ? from_col : 0); c < (r == to_row ? to_col : term->cols); c++) {
+            term->cells[r][c].ch = ' ';
+            term->cells[r][c].fg = 0;
+            term->cells[r][c].bold = false;
+        }
+    }
+}
+
+void term_line_feed(struct Terminal *term) {
+    term->row = term->row + 1;
+    if (term->row == term->rows) {
+        memmove(&term->cells[0], &term->cells[1], (size_t)(term->rows - 1) * sizeof(term->cells[0]));
+        term->row = term->rows - 1;
+        term_clear(term, term->row, 0, term->row, term->cols);
+    }
+}
+
+int clamp(int value, int low, int high) {
+    return value < low ? low : value > high ? high : value;
+}
+
+void term_print(struct Terminal *term, char ch) {
+    if (term->col == term->cols) {
+        term->col = 0;
+        term_line_feed(term);
+    }
+    struct Cell *cell = &term->cells[term->row][term->col];
+    cell->ch = ch;
+    cell->fg = term->fg;
+    cell->bold = term->bold;
+    term->col = term->col + 1;
+    term->last_ch = ch;
+}
+
+// Run a finished CSI sequence
+void term_csi(struct Terminal *term, char final) {
+    int *p = term->params;
+    int n = p[0] > 0 ? p[0] : 1;
+    int i;
+
+    if (term->private_mode) {
+        return;  // Cursor visibility, alternate screen and so on
+    }
+    if (final == 'H' || final == 'f') {
+        term->row = clamp((p[0] > 0 ? p[0] : 1) - 1, 0, term->rows - 1);
+        term->col = clamp((term->param_count > 1 && p[1] > 0 ? p[1] : 1) - 1, 0, term->cols - 1);
+    } else if (final == 'A') {
+        term->row = clamp(term->row - n, 0, term->rows - 1);
+    } else if (final == 'B') {
+        term->row = clamp(term->row + n, 0, term->rows - 1);
+    } else if (final == 'C') {
+        term->col = clamp(term->col + n, 0, term->cols - 1);
+    } else if (final == 'D') {
+        term->col = clamp(term->col - n, 0, term->cols - 1);
+    } else if (final == 'J') {
+        if (p[0] == 0) term_clear(term, term->row, term->col, term->rows - 1, term->cols);
+        else if (p[0] == 1) term_clear(term, 0, 0, term->row, term->col + 1);
+        else term_clear(term, 0, 0, term->rows - 1, term->cols);
+    } else if (final == 'K') {
+        if (p[0] == 0) term_clear(term, term->row, term->col, term->row, term->cols);
+        else if (p[0] == 1) term_clear(term, term->row, 0, term->row, term->col + 1);
+        else term_clear(term, term->row, 0, term->row, term->cols);
+    } else if (final == 'b') {
+        for (i = 0; i < n; i++) {
+            term_print(term, term->last_ch);
+        }
+    } else if (final == 'm') {
+        for (i = 0; i < term->param_count || i == 0; i++) {
+            if (p[i] == 38 || p[i] == 48) {
+                // 256 or 24-bit colour: not one of ours, skip its numbers
+                if (p[i] == 38) term->fg = 0;
+                i = i + (i + 1 < term->param_count && p[i + 1] == 2 ? 4 : 2);
+            } else if (p[i] == 0) {
+                term->fg = 0;
+                term->bold = false;
+            } else if (p[i] == 1) {
+                term->bold = true;
+            } else if (p[i] == 22) {
+                term->bold = false;
+            } else if (p[i] >= 30 && p[i] <= 37) {
+                term->fg = (unsigned char)p[i];
+            } else if (p[i] == 39) {
+                term->fg = 0;
+            }
+        }
+    }
+}
+
+void term_feed(struct Terminal *term, const unsigned char *data, int len) {
+    int i;
+
+    for (i = 0; i < len; i++) {
+        unsigned char ch = data[i];
+
+        if (term->state == 1) {
+            if (ch == '[') {
+                term->state = 2;
+                term->param_count = 0;
+                term->private_mode = false;
+                memset(term->params, 0, sizeof(term->params));
+            } else {
+                term->state = 0;  // Other escapes don't change the screen here
+            }
+        } else if (term->state == 2) {
+            if (ch >= '0' && ch <= '9') {
+                if (term->param_count == 0) term->param_count = 1;
+                int *param = &term->params[term->param_count - 1];
+                *param = *param * 10 + (ch - '0');
+            } else if (ch == ';') {
+                if (term->param_count == 0) term->param_count = 1;
+                if (term->param_count < MAX_PARAMS) term->param_count = term->param_count + 1;
+            } else if (ch == '?' || ch == '>' || ch == '=') {
+                term->private_mode = true;
+            } else if (ch >= 0x40 && ch <= 0x7e) {
+                term_csi(term, (char)ch);
+                term->state = 0;
+            }
+        } else if (ch == 0x1b) {
+            term->state = 1;
+        } else if (ch == '\r') {
+            term->col = 0;
+        } else if (ch == '\n') {
+            term_line_feed(term);
+        } else if (ch == '\b') {
+            if (term->col > 0) term->col = term->col - 1;
+        } else if (ch >= 0x20 && (ch & 0xc0) != 0x80) {
+            // Printable (a UTF-8 character takes one cell, shown as '?')
+            term_print(term, ch < 0x80 ? (char)ch : '?');
+        }
+    }
+}
+
+// Where pac-man is on screen (the legend's "C=Pac-Man" doesn't count)
+bool find_pacman(const struct Terminal *term, int *row, int *col) {
+    int r, c;
+    for (r = 0; r < term->rows; r++) {
+        for (c = 0; c < term->cols; c++) {
+            const struct Cell *cell = &term->cells[r][c];
+            if (cell->ch == 'C' && cell->bold && cell->fg == 33 &&
+                (c + 1 == term->cols || term->cells[r][c + 1].ch != '=')) {
+                *row = r;
+                *col = c;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+bool screen_has(const struct Terminal *term, const char *text) {
+    char line[MAX_TERM_COLS + 1];
+    int r, c;
+    for (r = 0; r < term->rows; r++) {
+        for (c = 0; c < term->cols; c++) {
+            line[c] = term->cells[r][c].ch;
+        }
+        line[term->cols] = '\0';
+        if (strstr(line, text) != NULL) {
+            return true;
+        }
+    }
+    return false;
+}
+
+struct Game {
+    int fd;                 // Pty master
+    pid_t pid;
+    bool exited;
+};
+
+// Start the game on a new pty of the given size
+bool game_start(struct Game *game, int rows, int cols, char **args) {
+    struct winsize size;
+
+    game->fd = posix_openpt(O_RDWR | O_NOCTTY);
+    if (game->fd < 0 || grantpt(game->fd) != 0 || unlockpt(game->fd) != 0) {
+        perror("posix_openpt");
+        return false;
+    }
+    memset(&size, 0, sizeof(size));
+    size.ws_row = (unsigned short)rows;
+    size.ws_col = (unsigned short)cols;
+
+    const char *slave_name = ptsname(game->fd);
+    game->exited = false;
+    game->pid = fork();
+    if (game->pid < 0) {
+        perror("fork");
+        return false;
+    }
+    if (game->pid == 0) {
+        setsid();
+        int slave = open(slave_name, O_RDWR);
+        if (slave < 0) _exit(127);
+#ifdef TIOCSCTTY
+        ioctl(slave, TIOCSCTTY, 0);
+#endif
+        ioctl(slave, TIOCSWINSZ, &size);
+        dup2(slave, 0);
+        dup2(slave, 1);
+        dup2(slave, 2);
+        if (slave > 2) close(slave);
+        close(game->fd);
+        execv(args[0], args);
+        _exit(127);
+    }
+
+    fcntl(game->fd, F_SETFL, fcntl(game->fd, F_GETFL) | O_NONBLOCK);
+    return true;
+}
+
+// Read whatever the game has drawn, waiting up to `wait_ms` for it.
+// Returns false once the game has gone.
+bool game_read(struct Game *game, struct Terminal *term, int wait_ms) {
+    unsigned char buf[65536];
+    struct pollfd pfd;
+
+    pfd.fd = game->fd;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    if (poll(&pfd, 1, wait_ms) <= 0) {
+        return true;
+    }
+    while (true) {
+        ssize_t n = read(game->fd, buf, sizeof(buf));
+        if (n > 0) {
+            term_feed(term, buf, (int)n);
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EINTR)) {
+            return true;
+        }
+        game->exited = true;  // EOF, or EIO once the game has closed the pty
+        return false;
+    }
+}
+
+void game_key(struct Game *game, char key) {
+    while (write(game->fd, &key, 1) < 0 && errno == EINTR) {
+    }
+}
+
+// Ask the game to quit, and make sure it does
+void game_stop(struct Game *game, struct Terminal *term) {
+    long deadline = platform_time_ms() + 2000;
+    int status;
+
+    game_key(game, 'q');
+    while (platform_time_ms() < deadline) {
+        game_read(game, term, 20);
+        if (waitpid(game->pid, &status, WNOHANG) == game->pid) {
+            close(game->fd);
+            return;
+        }
+    }
+    kill(game->pid, SIGKILL);
+    waitpid(game->pid, &status, 0);
+    close(game->fd);
+}
+
+int compare_long_long(const void *a, const void *b) {
+    long long x = *(const long long *)a;
+    long long y = *(const long long *)b;
+    return x < y ? -1 : x > y;
+}
+
+double percentile_ms(const long long *sorted, int count, int percent) {
+    int index = (count - 1) * percent / 100;
+    return (double)sorted[index] / 1000.0;
+}
+
+void print_usage(const char *program) {
+    fprintf(stderr, "Usage: %s [--game PATH] [--samples N] [--size ROWSxCOLS] [--max-p50 MS] [-- GAME ARGS...]\n",
+            program);
+}
+
+int main(int argc, char **argv) {
+    static struct Terminal term;
+    static char default_game[1024];
+    static char leaderboard[] = "/tmp/pacman_latency_XXXXXX";
+    struct Game game;
+    char *game_args[64];
+    int arg_count = 1;
+    int samples = 200;
+    double max_p50 = 0;
+    uint32_t rng = 12345;
+    int i;
+
+    // The game is next to us unless told otherwise
+    snprintf(default_game, sizeof(default_game), "%s", argv[0]);
+    char *slash = strrchr(default_game, '/');
+    snprintf(slash != NULL ? slash + 1 : default_game,
+             sizeof(default_game) - (size_t)(slash != NULL ? slash + 1 - default_game : 0), "pacman");
+    game_args[0] = default_game;
+    term.rows = 40;
+    term.cols = 120;
+
+    for (i = 1; i < argc; i++) {
+        const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+        bool ok = value != NULL;
+        if (strcmp(argv[i], "--") == 0) {
+            for (i = i + 1; i < argc && arg_count < 63; i++) {
+                game_args[arg_count] = argv[i];
+                arg_count = arg_count + 1;
+            }
+            break;
+        }
+        if (ok && strcmp(argv[i], "--game") == 0) game_args[0] = argv[i + 1];
+        else if (ok && strcmp(argv[i], "--samples") == 0) samples = atoi(value);
+        else if (ok && strcmp(argv[i], "--size") == 0) ok = sscanf(value, "%dx%d", &term.rows, &term.cols) == 2;
+        else if (ok && strcmp(argv[i], "--max-p50") == 0) max_p50 = atof(value);
+        else ok = false;
+
+        if (ok == false) {
+            print_usage(argv[0]);
+            return 1;
+        }
+        i = i + 1;
+    }
+    game_args[arg_count] = NULL;
+    if (samples <= 0 || term.rows < 10 || term.cols < 20 || term.rows > MAX_TERM_ROWS || term.cols > MAX_TERM_COLS) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    // Keep test scores out of the real leaderboard
+    int board = mkstemp(leaderboard);
+    if (board >= 0) {
+        close(board);
+        unlink(leaderboard);
+        setenv("PACMAN_LEADERBOARD", leaderboard, 1);
+    }
+
+    // Pac-man is found by his colour, and this emulator only knows the
+    // 16 basic ones, so don't let the game pick more
+    setenv("TERM", "xterm", 1);
+    unsetenv("COLORTERM");
+    unsetenv("WT_SESSION");
+
+    term_clear(&term, 0, 0, term.rows - 1, term.cols);
+    if (game_start(&game, term.rows, term.cols, game_args) == false) {
+        return 1;
+    }
+
+    // Wait for the first frame
+    long deadline = platform_time_ms() + 5000;
+    int row, col;
+    while (find_pacman(&term, &row, &col) == false && platform_time_ms() < deadline) {
+        if (game_read(&game, &term, 50) == false) {
+            break;
+        }
+    }
+    if (find_pacman(&term, &row, &col) == false) {
+        fprintf(stderr, "Error: %s never drew pac-man\n", game_args[0]);
+        game_stop(&game, &term);
+        return 1;
+    }
+
+    long long *latency = malloc((size_t)samples * sizeof(long long));
+    int measured = 0, lost = 0, attempts = 0;
+    static const char KEYS[4] = {'w', 's', 'a', 'd'};
+    static const int KEY_ROW[4] = {-1, 1, 0, 0};
+    static const int KEY_COL[4] = {0, 0, -1, 1};
+
+    while (measured < samples && attempts < samples * 3 && game.exited == false) {
+        attempts = attempts + 1;
+
+        // Let the game run for a random while, drawing as it goes
+        rng = rng * 1103515245u + 12345u;
+        long long gap_end = platform_time_us() + (MIN_GAP_MS + (long long)((rng >> 16) % (MAX_GAP_MS - MIN_GAP_MS))) * 1000;
+        while (platform_time_us() < gap_end && game.exited == false) {
+            game_read(&game, &term, (int)((gap_end - platform_time_us()) / 1000) + 1);
+        }
+
+        if (screen_has(&term, "MISSION")) {
+            game_key(&game, 'r');
+            game_read(&game, &term, 300);
+            continue;
+        }
+        if (find_pacman(&term, &row, &col) == false) {
+            continue;
+        }
+
+        // Pick a direction with an open tile
+        int k, pick = -1;
+        int first = (int)((rng >> 8) & 3);
+        for (k = 0; k < 4 && pick < 0; k++) {
+            int d = (first + k) & 3;
+            int r = row + KEY_ROW[d];
+            int c = col + KEY_COL[d];
+            if (r >= 0 && r < term.rows && c >= 0 && c < term.cols &&
+                (term.cells[r][c].ch == '.' || term.cells[r][c].ch == ' ')) {
+                pick = d;
+            }
+        }
+        if (pick < 0) {
+            continue;
+        }
+
+        int want_row = row + KEY_ROW[pick];
+        int want_col = col + KEY_COL[pick];
+        long long start = platform_time_us();
+        game_key(&game, KEYS[pick]);
+
+        // Wait for pac-man to show up on the new tile
+        bool landed = false;
+        while (platform_time_us() - start < SAMPLE_TIMEOUT_MS * 1000LL && game.exited == false) {
+            game_read(&game, &term, 5);
+            int now_row, now_col;
+            if (find_pacman(&term, &now_row, &now_col) && (now_row != row || now_col != col)) {
+                landed = now_row == want_row && now_col == want_col;
+                break;
+            }
+        }
+        if (landed) {
+            latency[measured] = platform_time_us() - start;
+            measured = measured + 1;
+        } else {
+            lost = lost + 1;
+        }
+    }
+    game_stop(&game, &term);
+    if (board >= 0) {
+        unlink(leaderboard);
+    }
+
+    if (measured == 0) {
+        fprintf(stderr, "Error: no samples (%d lost)\n", lost);
+        return 1;
+    }
+    qsort(latency, (size_t)measured, sizeof(long long), compare_long_long);
+    double mean = 0;
+    for (i = 0; i < measured; i++) {
+        mean = mean + (double)latency[i] / 1000.0;
+    }
+    mean = mean / measured;
+
+    printf("keypress to screen latency, %d samples (%d thrown away)\n", measured, lost);
+    printf("  min  %7.2f ms\n", percentile_ms(latency, measured, 0));
+    printf("  p50  %7.2f ms\n", percentile_ms(latency, measured, 50));
+    printf("  p90  %7.2f ms\n", percentile_ms(latency, measured, 90));
+    printf("  p99  %7.2f ms\n", percentile_ms(latency, measured, 99));
+    printf("  max  %7.2f ms\n", percentile_ms(latency, measured, 100));
+    printf("  mean %7.2f ms\n", mean);
+
+    double p50 = percentile_ms(latency, measured, 50);
+    free(latency);
+    if (measured < samples / 2) {
+        fprintf(stderr, "Error: only %d of %d samples landed\n", measured, samples);
+        return 1;
+    }
+    if (max_p50 > 0 && p50 > max_p50) {
+        fprintf(stderr, "Error: median latency %.2f ms is over %.2f ms\n", p50, max_p50);
+        return 1;
+    }
+    return 0;
+}
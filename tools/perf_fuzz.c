@@ -0,0 +1,613 @@
+/*
+ * Worst-case frame search (performance fuzzing).
+ *
+ * Plays headless games from generated key sequences and looks for the
+ * single frame that costs the most: the most bytes from app_render (which
+ * sends only what changed since the frame before; the opening frame,
+ * which draws everything, isn't counted), the longest app_tick time, or
+ * the longest whole frame (input, ticks and render). The search keeps a
+ * corpus of the worst cases found so far and makes new ones by mutating
+ * them (changing keys, tick counts, the game seed and the maze seed,
+ * cutting and splicing), so each round starts from the slowest games
+ * seen yet.
+ *
+ * Times are noisy, so the slowest frames of a run are measured again
+ * several times from a copy of the session taken just before them, and
+ * the median counts.
+ *
+ * At the end the worst cases are shrunk to the fewest steps that still
+ * give (nearly) as slow a frame and written out as repro files, which
+ * --replay plays back. A folder of them is a regression corpus for the
+ * renderer and ghost AI.
+ *
+ * Usage: pacman_perf_fuzz [options]
+ *   --metric bytes|tick|frame   What to make worse            (default frame)
+ *   --seconds N                 How long to search            (default 10)
+ *   --seed N                    Search seed                   (default 1)
+ *   --maze ROWSxCOLS            Play generated mazes of this size
+ *   --terminal ROWSxCOLS        Screen size to render for     (default 50x160)
+ *   --render SPEC               Terminal to render for, as the game's --render
+ *                               (default 16,ascii,norep)
+ *   --keep N                    Repros to write               (default 3)
+ *   --out DIR                   Existing folder for the repros (default .)
+ *
+ *        pacman_perf_fuzz --replay FILE...
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "app.h"
+#include "platform.h"
+#include "screen.h"
+
+#define METRIC_BYTES 0
+#define METRIC_TICK 1
+#define METRIC_FRAME 2
+
+#define MAX_STEPS 512
+#define MAX_STEP_TICKS 40
+#define CORPUS_SIZE 32
+#define START_STEPS 128
+
+// Frames of each run that get timed again, and how many times
+#define RETIME_FRAMES 4
+#define RETIME_REPEATS 7
+
+// A timed case still counts as slow while it's within this much of the
+// original when shrinking (bytes must match exactly)
+#define SHRINK_TOLERANCE 0.9
+
+const char *METRIC_NAMES[3] = {"bytes", "tick", "frame"};
+const char STEP_KEYS[] = "wasdr-";  // '-' = no key
+
+// One frame: press a key (or not), then run some ticks, then draw
+struct Step {
+    char key;
+    unsigned char ticks;
+};
+
+struct Case {
+    uint32_t seed;
+    uint32_t maze_seed;
+    int step_count;
+    struct Step steps[MAX_STEPS];
+    long long score;            // Worst frame: bytes or nanoseconds
+    int worst_step;
+};
+
+struct Fuzzer {
+    int metric;
+    int term_rows, term_cols;
+    int maze_rows, maze_cols;   // 0 = built-in maze
+
+    struct Level maze;
+    bool maze_loaded;
+    uint32_t maze_seed;         // Seed of the loaded maze
+
+    struct App *app;
+    struct App *saved;          // Session before a frame being timed again
+    size_t stride;
+    struct ScreenCaps caps;
+    struct Renderer renderer;
+    struct Screen saved_screen; // Renderer's screen before a frame being timed again
+    uint32_t rng;
+    long long runs;
+};
+
+uint32_t fuzz_random(struct Fuzzer *f) {
+    // xorshift32
+    f->rng ^= f->rng << 13;
+    f->rng ^= f->rng >> 17;
+    f->rng ^= f->rng << 5;
+    return f->rng;
+}
+
+int fuzz_below(struct Fuzzer *f, int n) {
+    return (int)(fuzz_random(f) % (uint32_t)n);
+}
+
+const struct Level *load_level(struct Fuzzer *f, uint32_t maze_seed) {
+    if (f->maze_rows == 0) {
+        return level_default();
+    }
+    if (f->maze_loaded && f->maze_seed == maze_seed) {
+        return &f->maze;
+    }
+    if (f->maze_loaded) {
+        level_free(&f->maze);
+    }
+    if (level_generate(&f->maze, f->maze_rows, f->maze_cols, maze_seed) == false) {
+        fprintf(stderr, "Error: maze size must be %dx%d to %dx%d\n",
+                LEVEL_MIN_SIZE, LEVEL_MIN_SIZE, LEVEL_MAX_SIZE, LEVEL_MAX_SIZE);
+        exit(1);
+    }
+    f->maze_loaded = true;
+    f->maze_seed = maze_seed;
+    return &f->maze;
+}
+
+bool fuzz_setup(struct Fuzzer *f) {
+    const struct Level *level = load_level(f, 1);
+    f->stride = app_session_size(level);
+    f->app = platform_aligned_alloc(CACHE_LINE_SIZE, f->stride);
+    f->saved = platform_aligned_alloc(CACHE_LINE_SIZE, f->stride);
+    renderer_init(&f->renderer, &f->caps);
+    renderer_resize(&f->renderer, f->term_rows, f->term_cols);
+    return f->app != NULL && f->saved != NULL;
+}
+
+// Set up the game and draw its opening frame. That frame draws the whole
+// screen, as the game's first frame does, so it isn't one of the steps:
+// they are scored against the diffed frames the game draws from then on.
+void start_case(struct Fuzzer *f, const struct Case *c) {
+    app_init(f->app, load_level(f, c->maze_seed), APP_HEADLESS);
+    app_seed(f->app, c->seed);
+    renderer_invalidate(&f->renderer);
+    f->app->needs_redraw = false;
+    app_render(f->app, &f->renderer);
+}
+
+// Play one frame and return what it cost
+long long run_step(struct Fuzzer *f, const struct Step *step) {
+    struct App *app = f->app;
+    long long bytes = 0;
+    int t;
+
+    long long start = platform_time_ns();
+    if (step->key != '-') {
+        app_handle_input(app, step->key);
+    }
+    for (t = 0; t < step->ticks; t++) {
+        app_tick(app);
+    }
+    long long ticked = platform_time_ns();
+    if (app->needs_redraw) {
+        app->needs_redraw = false;
+        bytes = app_render(app, &f->renderer);
+    }
+    long long end = platform_time_ns();
+
+    if (f->metric == METRIC_BYTES) return bytes;
+    if (f->metric == METRIC_TICK) return ticked - start;
+    return end - start;
+}
+
+int compare_long_long(const void *a, const void *b) {
+    long long x = *(const long long *)a;
+    long long y = *(const long long *)b;
+    return x < y ? -1 : x > y;
+}
+
+// Median cost of step `index`, each time from the same starting state
+long long retime_step(struct Fuzzer *f, const struct Case *c, int index) {
+    long long times[RETIME_REPEATS];
+    int i;
+
+    start_case(f, c);
+    for (i = 0; i < index; i++) {
+        run_step(f, &c->steps[i]);
+    }
+    memcpy(f->saved, f->app, f->stride);
+    f->saved_screen = f->renderer.screen;
+    for (i = 0; i < RETIME_REPEATS; i++) {
+        memcpy(f->app, f->saved, f->stride);
+        f->renderer.screen = f->saved_screen;
+        times[i] = run_step(f, &c->steps[index]);
+    }
+    qsort(times, RETIME_REPEATS, sizeof(long long), compare_long_long);
+    return times[RETIME_REPEATS / 2];
+}
+
+// Play the whole case and set its score to its worst frame
+void run_case(struct Fuzzer *f, struct Case *c) {
+    long long top_cost[RETIME_FRAMES];
+    int top_step[RETIME_FRAMES];
+    int i, k;
+
+    for (k = 0; k < RETIME_FRAMES; k++) {
+        top_cost[k] = -1;
+        top_step[k] = -1;
+    }
+
+    start_case(f, c);
+    for (i = 0; i < c->step_count; i++) {
+        long long cost = run_step(f, &c->steps[i]);
+        // Keep the few most expensive frames, most expensive first
+        for (k = 0; k < RETIME_FRAMES; k++) {
+            if (cost > top_cost[k]) {
+                memmove(&top_cost[k + 1], &top_cost[k], (size_t)(RETIME_FRAMES - 1 - k) * sizeof(long long));
+                memmove(&top_step[k + 1], &top_step[k], (size_t)(RETIME_FRAMES - 1 - k) * sizeof(int));
+                top_cost[k] = cost;
+                top_step[k] = i;
+                break;
+            }
+        }
+    }
+    f->runs = f->runs + 1;
+
+    c->score = top_cost[0];
+    c->worst_step = top_step[0];
+    if (f->metric == METRIC_BYTES || c->step_count == 0) {
+        return;  // Byte counts don't change from run to run
+    }
+
+    c->score = -1;
+    for (k = 0; k < RETIME_FRAMES && top_step[k] >= 0; k++) {
+        long long cost = retime_step(f, c, top_step[k]);
+        if (cost > c->score) {
+            c->score = cost;
+            c->worst_step = top_step[k];
+        }
+    }
+}
+
+void random_step(struct Fuzzer *f, struct Step *step) {
+    step->key = STEP_KEYS[fuzz_below(f, (int)sizeof(STEP_KEYS) - 1)];
+    step->ticks = (unsigned char)(1 + fuzz_below(f, MAX_STEP_TICKS));
+}
+
+void random_case(struct Fuzzer *f, struct Case *c) {
+    int i;
+    c->seed = fuzz_random(f);
+    c->maze_seed = fuzz_random(f);
+    c->step_count = START_STEPS;
+    for (i = 0; i < c->step_count; i++) {
+        random_step(f, &c->steps[i]);
+    }
+}
+
+// Make a new case from `c` (and maybe `other`) with a few random changes
+void mutate_case(struct Fuzzer *f, struct Case *c, const struct Case *other) {
+    int changes = 1 + fuzz_below(f, 4);
+    int n, i;
+
+    for (n = 0; n < changes; n++) {
+        int kind = fuzz_below(f, 8);
+        int at = c->step_count > 0 ? fuzz_below(f, c->step_count) : 0;
+
+        if (kind <= 1 && c->step_count > 0) {
+            // Different key or tick count
+            random_step(f, &c->steps[at]);
+        } else if (kind == 2 && c->step_count < MAX_STEPS) {
+            // Insert a run of steps
+            int count = 1 + fuzz_below(f, 16);
+            if (count > MAX_STEPS - c->step_count) count = MAX_STEPS - c->step_count;
+            memmove(&c->steps[at + count], &c->steps[at], (size_t)(c->step_count - at) * sizeof(struct Step));
+            for (i = 0; i < count; i++) {
+                random_step(f, &c->steps[at + i]);
+            }
+            c->step_count = c->step_count + count;
+        } else if (kind == 3 && c->step_count > 1) {
+            // Delete a run of steps
+            int count = 1 + fuzz_below(f, 16);
+            if (count > c->step_count - at) count = c->step_count - at;
+            memmove(&c->steps[at], &c->steps[at + count], (size_t)(c->step_count - at - count) * sizeof(struct Step));
+            c->step_count = c->step_count - count;
+        } else if (kind == 4) {
+            // Repeat the steps leading up to the worst frame, to push the
+            // game further the same way
+            int from = c->worst_step > 8 ? c->worst_step - 8 : 0;
+            int count = c->worst_step + 1 - from;
+            if (count > 0 && c->step_count + count <= MAX_STEPS && c->worst_step < c->step_count) {
+                memmove(&c->steps[c->worst_step + 1 + count], &c->steps[c->worst_step + 1],
+                        (size_t)(c->step_count - c->worst_step - 1) * sizeof(struct Step));
+                memcpy(&c->steps[c->worst_step + 1], &c->steps[from], (size_t)count * sizeof(struct Step));
+                c->step_count = c->step_count + count;
+            }
+        } else if (kind == 5 && other != NULL) {
+            // Splice: our start, the other case's end
+            int cut = fuzz_below(f, other->step_count + 1);
+            int count = other->step_count - cut;
+            if (count > MAX_STEPS - at) count = MAX_STEPS - at;
+            memcpy(&c->steps[at], &other->steps[cut], (size_t)count * sizeof(struct Step));
+            c->step_count = at + count;
+        } else if (kind == 6) {
+            c->seed = fuzz_random(f);
+        } else if (kind == 7 && f->maze_rows > 0 && fuzz_below(f, 4) == 0) {
+            // New mazes are slow to make, so change it less often
+            c->maze_seed = fuzz_random(f);
+        }
+    }
+    if (c->step_count == 0) {
+        random_step(f, &c->steps[0]);
+        c->step_count = 1;
+    }
+}
+
+// Is `c` still as bad as `score`?
+bool still_bad(struct Fuzzer *f, struct Case *c, long long score) {
+    run_case(f, c);
+    if (f->metric == METRIC_BYTES) {
+        return c->score >= score;
+    }
+    return (double)c->score >= (double)score * SHRINK_TOLERANCE;
+}
+
+// Cut the case down to the fewest steps that still give a frame as bad
+void shrink_case(struct Fuzzer *f, struct Case *c) {
+    struct Case *trial = malloc(sizeof(struct Case));
+    long long score = c->score;
+    int chunk, at, i;
+
+    // Nothing after the worst frame matters
+    c->step_count = c->worst_step + 1;
+
+    // Delete runs of steps, big runs first
+    for (chunk = c->step_count / 2; chunk >= 1; chunk = chunk / 2) {
+        at = 0;
+        while (at < c->step_count && c->step_count > 1) {
+            int count = chunk < c->step_count - at ? chunk : c->step_count - at;
+            *trial = *c;
+            memmove(&trial->steps[at], &trial->steps[at + count],
+                    (size_t)(trial->step_count - at - count) * sizeof(struct Step));
+            trial->step_count = trial->step_count - count;
+            if (trial->step_count > 0 && still_bad(f, trial, score)) {
+                trial->step_count = trial->worst_step + 1;
+                *c = *trial;
+            } else {
+                at = at + chunk;
+            }
+        }
+    }
+
+    // Fewer ticks per step, and no key where it isn't needed
+    for (i = 0; i < c->step_count; i++) {
+        if (c->steps[i].ticks > 1) {
+            *trial = *c;
+            trial->steps[i].ticks = 1;
+            if (still_bad(f, trial, score)) {
+                *c = *trial;
+            }
+        }
+        if (c->steps[i].key != '-') {
+            *trial = *c;
+            trial->steps[i].key = '-';
+            if (still_bad(f, trial, score)) {
+                *c = *trial;
+            }
+        }
+    }
+
+    run_case(f, c);
+    free(trial);
+}
+
+bool write_repro(const struct Fuzzer *f, const struct Case *c, const char *path) {
+    FILE *file = fopen(path, "w");
+    int i;
+
+    if (file == NULL) {
+        perror(path);
+        return false;
+    }
+    fprintf(file, "# Worst frame found by pacman_perf_fuzz. Replay with: pacman_perf_fuzz --replay FILE\n");
+    fprintf(file, "metric %s\n", METRIC_NAMES[f->metric]);
+    fprintf(file, "value %lld\n", c->score);
+    fprintf(file, "terminal %dx%d\n", f->term_rows, f->term_cols);
+    fprintf(file, "render %s,%s,%s\n",
+            f->caps.colors == SCREEN_COLORS_24BIT ? "truecolor" : f->caps.colors == SCREEN_COLORS_256 ? "256" : "16",
+            f->caps.unicode ? "unicode" : "ascii", f->caps.repeat ? "rep" : "norep");
+    if (f->maze_rows > 0) {
+        fprintf(file, "maze %dx%d:%u\n", f->maze_rows, f->maze_cols, c->maze_seed);
+    } else {
+        fprintf(file, "maze default\n");
+    }
+    fprintf(file, "seed %u\n", c->seed);
+    fprintf(file, "steps %d\n", c->step_count);
+    for (i = 0; i < c->step_count; i++) {
+        fprintf(file, "%c %d\n", c->steps[i].key, c->steps[i].ticks);
+    }
+    fclose(file);
+    return true;
+}
+
+bool read_repro(struct Fuzzer *f, struct Case *c, long long *recorded, const char *path) {
+    FILE *file = fopen(path, "r");
+    char line[256], word[64];
+    int i;
+
+    if (file == NULL) {
+        perror(path);
+        return false;
+    }
+    memset(c, 0, sizeof(*c));
+    f->metric = -1;
+    f->maze_rows = 0;
+    f->maze_cols = 0;
+    c->step_count = -1;
+
+    while (c->step_count < 0 && fgets(line, sizeof(line), file) != NULL) {
+        if (line[0] == '#') continue;
+        if (sscanf(line, "metric %63s", word) == 1) {
+            for (i = 0; i < 3; i++) {
+                if (strcmp(word, METRIC_NAMES[i]) == 0) f->metric = i;
+            }
+        }
+        sscanf(line, "value %lld", recorded);
+        sscanf(line, "terminal %dx%d", &f->term_rows, &f->term_cols);
+        if (sscanf(line, "render %63s", word) == 1 && screen_parse_caps(&f->caps, word) == false) {
+            c->step_count = 0;
+            break;
+        }
+        sscanf(line, "maze %dx%d:%u", &f->maze_rows, &f->maze_cols, &c->maze_seed);
+        sscanf(line, "seed %u", &c->seed);
+        sscanf(line, "steps %d", &c->step_count);
+    }
+
+    bool ok = f->metric >= 0 && c->step_count > 0 && c->step_count <= MAX_STEPS;
+    for (i = 0; ok && i < c->step_count; i++) {
+        int ticks;
+        ok = fgets(line, sizeof(line), file) != NULL && sscanf(line, "%c %d", &c->steps[i].key, &ticks) == 2 &&
+             strchr(STEP_KEYS, c->steps[i].key) != NULL && ticks >= 1 && ticks <= 255;
+        c->steps[i].ticks = (unsigned char)ticks;
+    }
+    fclose(file);
+    if (ok == false) {
+        fprintf(stderr, "Error: %s is not a perf fuzz repro\n", path);
+    }
+    return ok;
+}
+
+const char *metric_unit(int metric) {
+    return metric == METRIC_BYTES ? "bytes" : "ns";
+}
+
+int replay(int count, char **paths) {
+    static struct Fuzzer f;
+    static struct Case c;
+    int i;
+
+    for (i = 0; i < count; i++) {
+        long long recorded = 0;
+        memset(&f, 0, sizeof(f));
+        if (read_repro(&f, &c, &recorded, paths[i]) == false) {
+            return 1;
+        }
+        if (fuzz_setup(&f) == false) {
+            fprintf(stderr, "Error: out of memory\n");
+            return 1;
+        }
+        run_case(&f, &c);
+        printf("%s: worst %s at step %d of %d: %lld %s (recorded %lld)\n",
+               paths[i], METRIC_NAMES[f.metric], c.worst_step + 1, c.step_count,
+               c.score, metric_unit(f.metric), recorded);
+        platform_aligned_free(f.app);
+        platform_aligned_free(f.saved);
+        if (f.maze_loaded) {
+            level_free(&f.maze);
+        }
+    }
+    return 0;
+}
+
+int compare_cases(const void *a, const void *b) {
+    const struct Case *x = *(struct Case *const *)a;
+    const struct Case *y = *(struct Case *const *)b;
+    return x->score > y->score ? -1 : x->score < y->score;
+}
+
+void print_usage(const char *program) {
+    fprintf(stderr,
+            "Usage: %s [--metric bytes|tick|frame] [--seconds N] [--seed N] [--maze ROWSxCOLS]\n"
+            "          [--terminal ROWSxCOLS] [--render SPEC] [--keep N] [--out DIR]\n"
+            "       %s --replay FILE...\n",
+            program, program);
+}
+
+int main(int argc, char **argv) {
+    static struct Fuzzer f;
+    const char *out_dir = ".";
+    int seconds = 10;
+    int keep = 3;
+    int i;
+
+    if (argc > 1 && strcmp(argv[1], "--replay") == 0) {
+        if (argc < 3) {
+            print_usage(argv[0]);
+            return 1;
+        }
+        return replay(argc - 2, argv + 2);
+    }
+
+    f.metric = METRIC_FRAME;
+    f.term_rows = 50;
+    f.term_cols = 160;
+    f.rng = 1;
+    for (i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+        bool ok = value != NULL;
+        if (ok && strcmp(arg, "--metric") == 0) {
+            f.metric = -1;
+            if (strcmp(value, "bytes") == 0) f.metric = METRIC_BYTES;
+            if (strcmp(value, "tick") == 0) f.metric = METRIC_TICK;
+            if (strcmp(value, "frame") == 0) f.metric = METRIC_FRAME;
+            ok = f.metric >= 0;
+        }
+        else if (ok && strcmp(arg, "--seconds") == 0) seconds = atoi(value);
+        else if (ok && strcmp(arg, "--seed") == 0) f.rng = (uint32_t)strtoul(value, NULL, 10);
+        else if (ok && strcmp(arg, "--maze") == 0) ok = sscanf(value, "%dx%d", &f.maze_rows, &f.maze_cols) == 2;
+        else if (ok && strcmp(arg, "--terminal") == 0) ok = sscanf(value, "%dx%d", &f.term_rows, &f.term_cols) == 2;
+        else if (ok && strcmp(arg, "--render") == 0) ok = screen_parse_caps(&f.caps, value);
+        else if (ok && strcmp(arg, "--keep") == 0) keep = atoi(value);
+        else if (ok && strcmp(arg, "--out") == 0) out_dir = value;
+        else ok = false;
+
+        if (ok == false) {
+            print_usage(argv[0]);
+            return 1;
+        }
+        i = i + 1;
+    }
+    if (seconds <= 0 || keep <= 0 || keep > CORPUS_SIZE || f.rng == 0 || f.term_rows <= 0 || f.term_cols <= 0) {
+        print_usage(argv[0]);
+        return 1;
+    }
+    if (fuzz_setup(&f) == false) {
+        fprintf(stderr, "Error: out of memory\n");
+        return 1;
+    }
+
+    // Start from random games
+    struct Case *corpus[CORPUS_SIZE];
+    struct Case *child = malloc(sizeof(struct Case));
+    for (i = 0; i < CORPUS_SIZE; i++) {
+        corpus[i] = malloc(sizeof(struct Case));
+        random_case(&f, corpus[i]);
+        run_case(&f, corpus[i]);
+    }
+    qsort(corpus, CORPUS_SIZE, sizeof(struct Case *), compare_cases);
+    long long first_best = corpus[0]->score;
+
+    // Mutate the worst cases so far. Parents are picked from the top of
+    // the corpus more often than the bottom.
+    long long deadline = platform_time_us() + (long long)seconds * 1000000LL;
+    long long next_report = platform_time_us() + 1000000LL;
+    while (platform_time_us() < deadline) {
+        int parent = fuzz_below(&f, 1 + fuzz_below(&f, CORPUS_SIZE));
+        *child = *corpus[parent];
+        mutate_case(&f, child, corpus[fuzz_below(&f, CORPUS_SIZE)]);
+        run_case(&f, child);
+
+        // Replace the mildest case if this one is worse
+        if (child->score > corpus[CORPUS_SIZE - 1]->score) {
+            struct Case *swap = corpus[CORPUS_SIZE - 1];
+            corpus[CORPUS_SIZE - 1] = child;
+            child = swap;
+            qsort(corpus, CORPUS_SIZE, sizeof(struct Case *), compare_cases);
+        }
+
+        if (platform_time_us() >= next_report) {
+            fprintf(stderr, "%lld runs, worst frame %lld %s\n", f.runs, corpus[0]->score, metric_unit(f.metric));
+            next_report = next_report + 1000000LL;
+        }
+    }
+    fprintf(stderr, "%lld runs: worst %s went from %lld to %lld %s\n", f.runs, METRIC_NAMES[f.metric],
+            first_best, corpus[0]->score, metric_unit(f.metric));
+
+    // Shrink and save the worst few
+    for (i = 0; i < keep; i++) {
+        char path[1024];
+        int before = corpus[i]->step_count;
+        shrink_case(&f, corpus[i]);
+        snprintf(path, sizeof(path), "%s/worst-%s-%d.repro", out_dir, METRIC_NAMES[f.metric], i + 1);
+        if (write_repro(&f, corpus[i], path) == false) {
+            return 1;
+        }
+        fprintf(stderr, "%s: %lld %s, %d steps (from %d)\n", path, corpus[i]->score,
+                metric_unit(f.metric), corpus[i]->step_count, before);
+    }
+
+    for (i = 0; i < CORPUS_SIZE; i++) {
+        free(corpus[i]);
+    }
+    free(child);
+    platform_aligned_free(f.app);
+    platform_aligned_free(f.saved);
+    if (f.maze_loaded) {
+        level_free(&f.maze);
+    }
+    return 0;
+}
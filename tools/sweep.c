@@ -0,0 +1,334 @@
+/*
+ * Ghost AI parameter sweep.
+ *
+ * Plays lots of headless games for every combination of ghost settings
+ * and writes one CSV row per combination. Games are spread over all
+ * cores, and each game is seeded from --seed plus its number, so every
+ * combination plays the same set of games and a rerun gives the same CSV.
+ *
+ * Usage: pacman_sweep [options]
+ *   --lookahead LIST   Pink ghost lookahead in tiles      (default 4)
+ *   --flank LIST       Cyan ghost flank offset in tiles   (default 3)
+ *   --chase LIST       Orange ghost chase chance, percent (default 30)
+ *   --tick LIST        Milliseconds between ghost moves   (default 400)
+ *   --games N          Games per combination              (default 1000)
+ *   --seed N           First game seed                    (default 1)
+ *   --threads N        Worker threads                     (default: all cores)
+ *   --player bot|random                                   (default bot)
+ *   --move-ms N        Time between player moves          (default 150)
+ *   --max-seconds N    Give up on a game after this much game time (default 2000)
+ *   --out FILE         Write the CSV here instead of stdout
+ *   --telemetry FILE   Log every game's events here (see telemetry.h)
+ *   --ai-detail SPEC   Ghost AI level of detail: full or fixed:N (default full)
+ *
+ * A LIST is comma separated, e.g. --lookahead 2,4,6 --tick 300,400.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "app.h"
+#include "atomics.h"
+#include "bot.h"
+#include "platform.h"
+#include "telemetry.h"
+
+#define MAX_VALUES 32
+
+// Games handed to a worker at a time. They are played side by side, and
+// 16 sessions' ghosts fill a GhostBatch.
+#define GAMES_PER_CLAIM 16
+
+struct ValueList {
+    int values[MAX_VALUES];
+    int count;
+};
+
+// Totals for one combination of settings
+struct SweepTotals {
+    long long games;
+    long long wins;
+    long long time_ms;
+    long long dots;
+    long long lives_used;
+    long long ai_full;
+    long long ai_cheap;
+};
+
+struct Sweep {
+    struct GhostParams *configs;
+    int config_count;
+    int games;
+    uint32_t seed;
+    int player;
+    int move_ms;
+    long max_ms;
+    const struct Level *level;
+    volatile int next_claim;   // Next block of work to hand out
+    int claim_count;
+};
+
+struct Worker {
+    struct Sweep *sweep;
+    struct SweepTotals *totals;   // One per config, merged at the end
+    struct PlatformThread *thread;
+};
+
+bool parse_list(const char *text, struct ValueList *list) {
+    list->count = 0;
+    while (*text != '\0') {
+        char *end;
+        long value = strtol(text, &end, 10);
+        if (end == text || list->count == MAX_VALUES) {
+            return false;
+        }
+        list->values[list->count] = (int)value;
+        list->count = list->count + 1;
+        text = end;
+        if (*text == ',') {
+            text = text + 1;
+        }
+    }
+    return list->count > 0;
+}
+
+void worker_thread(void *arg) {
+    struct Worker *worker = arg;
+    struct Sweep *sweep = worker->sweep;
+    struct App *apps[GAMES_PER_CLAIM];
+    uint32_t seeds[GAMES_PER_CLAIM];
+    struct BotResult results[GAMES_PER_CLAIM];
+    struct Bot bot;
+    int i;
+
+    for (i = 0; i < GAMES_PER_CLAIM; i++) {
+        apps[i] = platform_aligned_alloc(CACHE_LINE_SIZE, app_session_size(sweep->level));
+        if (apps[i] == NULL) {
+            fprintf(stderr, "Error: out of memory\n");
+            exit(1);
+        }
+    }
+    if (bot_init(&bot, sweep->player, sweep->level, 0) == false) {
+        fprintf(stderr, "Error: out of memory\n");
+        exit(1);
+    }
+    telemetry_attach();
+
+    while (true) {
+        int claim = atom_add(&sweep->next_claim, 1);
+        if (claim >= sweep->claim_count) {
+            break;
+        }
+
+        int claims_per_config = (sweep->games + GAMES_PER_CLAIM - 1) / GAMES_PER_CLAIM;
+        int config = claim / claims_per_config;
+        int first = (claim % claims_per_config) * GAMES_PER_CLAIM;
+        int last = first + GAMES_PER_CLAIM;
+        if (last > sweep->games) last = sweep->games;
+
+        // The claim's games are played side by side, so their ghosts are
+        // scored together
+        struct SweepTotals *totals = &worker->totals[config];
+        int count = last - first;
+        for (i = 0; i < count; i++) {
+            int game = first + i;
+            seeds[i] = sweep->seed + (uint32_t)game;
+            app_init(apps[i], sweep->level, APP_HEADLESS);
+            app_set_params(apps[i], &sweep->configs[config]);
+            app_seed(apps[i], seeds[i]);
+            apps[i]->id = (uint32_t)(config * sweep->games + game);
+        }
+
+        bot_play_games(&bot, apps, seeds, count, sweep->move_ms, sweep->max_ms, results);
+
+        for (i = 0; i < count; i++) {
+            struct App *app = apps[i];
+            totals->games = totals->games + 1;
+            totals->wins = totals->wins + (results[i].won ? 1 : 0);
+            totals->time_ms = totals->time_ms + results[i].time_ms;
+            totals->dots = totals->dots + results[i].dots_eaten;
+            // The life in play at the end counts too, unless the game was lost
+            totals->lives_used = totals->lives_used + results[i].lives_lost + (app->game_over ? 0 : 1);
+            totals->ai_full = totals->ai_full + app->ai_full;
+            totals->ai_cheap = totals->ai_cheap + app->ai_cheap;
+        }
+    }
+
+    bot_free(&bot);
+    for (i = 0; i < GAMES_PER_CLAIM; i++) {
+        platform_aligned_free(apps[i]);
+    }
+}
+
+void print_usage(const char *program) {
+    fprintf(stderr,
+            "Usage: %s [--lookahead LIST] [--flank LIST] [--chase LIST] [--tick LIST]\n"
+            "          [--games N] [--seed N] [--threads N] [--player bot|random]\n"
+            "          [--move-ms N] [--max-seconds N] [--out FILE] [--telemetry FILE]\n"
+            "          [--ai-detail full|fixed:N]\n",
+            program);
+}
+
+int main(int argc, char **argv) {
+    struct ValueList lookahead = {{4}, 1};
+    struct ValueList flank = {{3}, 1};
+    struct ValueList chase = {{30}, 1};
+    struct ValueList tick = {{GAME_TICK_MS}, 1};
+    struct Sweep sweep;
+    const char *out_path = NULL;
+    const char *telemetry_path = NULL;
+    struct GhostParams base = GHOST_PARAMS_DEFAULT;
+    int threads = platform_cpu_count();
+    int i, a, f, c, t;
+
+    memset(&sweep, 0, sizeof(sweep));
+    sweep.games = 1000;
+    sweep.seed = 1;
+    sweep.player = BOT_GREEDY;
+    sweep.move_ms = BOT_MOVE_MS;
+    sweep.max_ms = 2000 * 1000L;
+
+    for (i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+        bool ok = value != NULL;
+        if (ok && strcmp(arg, "--lookahead") == 0) ok = parse_list(value, &lookahead);
+        else if (ok && strcmp(arg, "--flank") == 0) ok = parse_list(value, &flank);
+        else if (ok && strcmp(arg, "--chase") == 0) ok = parse_list(value, &chase);
+        else if (ok && strcmp(arg, "--tick") == 0) ok = parse_list(value, &tick);
+        else if (ok && strcmp(arg, "--games") == 0) sweep.games = atoi(value);
+        else if (ok && strcmp(arg, "--seed") == 0) sweep.seed = (uint32_t)strtoul(value, NULL, 10);
+        else if (ok && strcmp(arg, "--threads") == 0) threads = atoi(value);
+        else if (ok && strcmp(arg, "--move-ms") == 0) sweep.move_ms = atoi(value);
+        else if (ok && strcmp(arg, "--max-seconds") == 0) sweep.max_ms = atol(value) * 1000L;
+        else if (ok && strcmp(arg, "--out") == 0) out_path = value;
+        else if (ok && strcmp(arg, "--telemetry") == 0) telemetry_path = value;
+        else if (ok && strcmp(arg, "--ai-detail") == 0) ok = ghost_params_parse_detail(&base, value);
+        else if (ok && strcmp(arg, "--player") == 0 && strcmp(value, "bot") == 0) sweep.player = BOT_GREEDY;
+        else if (ok && strcmp(arg, "--player") == 0 && strcmp(value, "random") == 0) sweep.player = BOT_RANDOM;
+        else ok = false;
+
+        if (ok == false) {
+            print_usage(argv[0]);
+            return 1;
+        }
+        i = i + 1;
+    }
+    if (sweep.games <= 0 || threads <= 0 || sweep.move_ms <= 0 || sweep.max_ms <= 0) {
+        print_usage(argv[0]);
+        return 1;
+    }
+    if (base.detail == AI_DETAIL_TIMED) {
+        fprintf(stderr, "Error: timed:US depends on how fast the machine is, so reruns wouldn't match, use --ai-detail fixed:N\n");
+        return 1;
+    }
+    for (t = 0; t < tick.count; t++) {
+        if (tick.values[t] <= 0) {
+            fprintf(stderr, "Error: --tick values must be positive\n");
+            return 1;
+        }
+    }
+
+    // Every combination of the lists
+    sweep.level = level_default();
+    sweep.config_count = lookahead.count * flank.count * chase.count * tick.count;
+    sweep.configs = malloc((size_t)sweep.config_count * sizeof(struct GhostParams));
+    int n = 0;
+    for (a = 0; a < lookahead.count; a++) {
+        for (f = 0; f < flank.count; f++) {
+            for (c = 0; c < chase.count; c++) {
+                for (t = 0; t < tick.count; t++) {
+                    struct GhostParams *params = &sweep.configs[n];
+                    *params = base;
+                    params->behaviours[GHOST_AMBUSHER].lookahead = lookahead.values[a];
+                    params->behaviours[GHOST_FLANKER].flank = flank.values[f];
+                    params->behaviours[GHOST_RANDOM].chase_percent = chase.values[c];
+                    params->tick_ms = tick.values[t];
+                    n = n + 1;
+                }
+            }
+        }
+    }
+    sweep.claim_count = sweep.config_count * ((sweep.games + GAMES_PER_CLAIM - 1) / GAMES_PER_CLAIM);
+
+    if (telemetry_path != NULL && telemetry_start(telemetry_path) == false) {
+        return 1;
+    }
+
+    // Run the workers
+    struct Worker *workers = calloc((size_t)threads, sizeof(struct Worker));
+    long long start = platform_time_us();
+    for (i = 0; i < threads; i++) {
+        workers[i].sweep = &sweep;
+        workers[i].totals = calloc((size_t)sweep.config_count, sizeof(struct SweepTotals));
+        workers[i].thread = platform_thread_start(worker_thread, &workers[i]);
+        if (workers[i].thread == NULL) {
+            fprintf(stderr, "Error: could not start thread %d\n", i);
+            return 1;
+        }
+    }
+    for (i = 0; i < threads; i++) {
+        platform_thread_join(workers[i].thread);
+    }
+    long long elapsed = platform_time_us() - start;
+
+    if (telemetry_path != NULL) {
+        struct TelemetryStats stats;
+        telemetry_stop(&stats);
+        fprintf(stderr, "Logged %llu events to %s (%llu bytes, %llu events dropped)\n",
+                (unsigned long long)stats.events, telemetry_path,
+                (unsigned long long)stats.file_bytes, (unsigned long long)stats.dropped);
+    }
+
+    // Merge and write the results
+    FILE *out = stdout;
+    if (out_path != NULL) {
+        out = fopen(out_path, "w");
+        if (out == NULL) {
+            perror(out_path);
+            return 1;
+        }
+    }
+    fprintf(out, "ambush_lookahead,flank_offset,random_chase_percent,tick_ms,games,wins,win_rate,avg_survival_ms,avg_dots,dots_per_life,cheap_decision_rate\n");
+    for (n = 0; n < sweep.config_count; n++) {
+        struct SweepTotals sum;
+        memset(&sum, 0, sizeof(sum));
+        for (i = 0; i < threads; i++) {
+            sum.games = sum.games + workers[i].totals[n].games;
+            sum.wins = sum.wins + workers[i].totals[n].wins;
+            sum.time_ms = sum.time_ms + workers[i].totals[n].time_ms;
+            sum.dots = sum.dots + workers[i].totals[n].dots;
+            sum.lives_used = sum.lives_used + workers[i].totals[n].lives_used;
+            sum.ai_full = sum.ai_full + workers[i].totals[n].ai_full;
+            sum.ai_cheap = sum.ai_cheap + workers[i].totals[n].ai_cheap;
+        }
+        const struct GhostParams *params = &sweep.configs[n];
+        fprintf(out, "%d,%d,%d,%d,%lld,%lld,%.4f,%.1f,%.1f,%.2f,%.4f\n",
+                params->behaviours[GHOST_AMBUSHER].lookahead,
+                params->behaviours[GHOST_FLANKER].flank,
+                params->behaviours[GHOST_RANDOM].chase_percent,
+                params->tick_ms,
+                sum.games, sum.wins,
+                (double)sum.wins / (double)sum.games,
+                (double)sum.time_ms / (double)sum.games,
+                (double)sum.dots / (double)sum.games,
+                (double)sum.dots / (double)(sum.lives_used > 0 ? sum.lives_used : 1),
+                (double)sum.ai_cheap / (double)(sum.ai_full + sum.ai_cheap > 0 ? sum.ai_full + sum.ai_cheap : 1));
+    }
+    if (out != stdout) {
+        fclose(out);
+    }
+
+    long long total_games = (long long)sweep.config_count * sweep.games;
+    fprintf(stderr, "%lld games on %d threads in %.2f s (%.0f games/s)\n",
+            total_games, threads, (double)elapsed / 1e6,
+            (double)total_games * 1e6 / (double)(elapsed > 0 ? elapsed : 1));
+
+    for (i = 0; i < threads; i++) {
+        free(workers[i].totals);
+    }
+    free(workers);
+    free(sweep.configs);
+    return 0;
+}
@@ -0,0 +1,71 @@
+/*
+ * Telemetry log to CSV.
+ *
+ * Reads a log written with --telemetry (or PACMAN_TELEMETRY) and prints
+ * one CSV row per event: tick, session, event, row, col, ghost, dir.
+ * ghost and dir are empty when the event has none.
+ *
+ * Usage: pacman_telemetry LOG [--out FILE]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "telemetry.h"
+
+const char *GHOST_NAMES[4] = {"red", "pink", "cyan", "orange"};
+const char *DIR_NAMES[4] = {"up", "down", "left", "right"};
+
+int main(int argc, char **argv) {
+    const char *out_path = NULL;
+    struct TelemetryReader reader;
+    int count, i;
+
+    if (argc == 4 && strcmp(argv[2], "--out") == 0) {
+        out_path = argv[3];
+    } else if (argc != 2) {
+        fprintf(stderr, "Usage: %s LOG [--out FILE]\n", argv[0]);
+        return 1;
+    }
+
+    if (telemetry_reader_open(&reader, argv[1]) == false) {
+        return 1;
+    }
+    struct TelemetryEvent *events = malloc(TELEMETRY_BLOCK_EVENTS * sizeof(struct TelemetryEvent));
+    if (events == NULL) {
+        fprintf(stderr, "Error: out of memory\n");
+        return 1;
+    }
+
+    FILE *out = stdout;
+    if (out_path != NULL) {
+        out = fopen(out_path, "w");
+        if (out == NULL) {
+            perror(out_path);
+            return 1;
+        }
+    }
+
+    fprintf(out, "tick,session,event,row,col,ghost,dir\n");
+    while ((count = telemetry_reader_next(&reader, events)) > 0) {
+        for (i = 0; i < count; i++) {
+            const struct TelemetryEvent *event = &events[i];
+            fprintf(out, "%u,%u,%s,%u,%u,%s,%s\n",
+                    event->tick, event->session, telemetry_type_name(event->type),
+                    event->row, event->col,
+                    event->ghost < 4 ? GHOST_NAMES[event->ghost] : "",
+                    event->dir < 4 ? DIR_NAMES[event->dir] : "");
+        }
+    }
+    if (count < 0) {
+        fprintf(stderr, "Error: %s is damaged, stopped reading\n", argv[1]);
+    }
+
+    if (out != stdout) {
+        fclose(out);
+    }
+    telemetry_reader_close(&reader);
+    free(events);
+    return count < 0 ? 1 : 0;
+}
@@ -0,0 +1,218 @@
+/*
+ * Follow a running game from another process.
+ *
+ * Reads the state a game shares with --share NAME, 1000 times a second
+ * by default, and prints a line whenever it changes (or, with --map, the
+ * part of the maze around pac-man). When the game exits or time is up
+ * it says how many states it saw, how many were replaced between two
+ * reads, how often a read raced the game and had to try again, and how
+ * old states were by the time they were read.
+ *
+ * Usage: pacman_watch NAME [options]
+ *   --hz N           Reads per second                (default 1000)
+ *   --seconds N      Stop after this long            (default: when the game exits)
+ *   --map            Draw the maze instead of a line per change
+ *   --quiet          Only print the summary
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "platform.h"
+#include "shared_state.h"
+
+// Largest part of the maze --map draws
+#define WATCH_MAP_ROWS 40
+#define WATCH_MAP_COLS 120
+
+struct WatchStats {
+    unsigned long reads;
+    unsigned long failed;         // Reads that gave up: the game was always writing
+    unsigned long seen;           // Different states read
+    unsigned long missed;         // States written and replaced between two reads
+    long long age_ns;             // Summed over `seen`: how old a state was when first read
+    long long max_age_ns;
+};
+
+void print_usage(const char *program) {
+    fprintf(stderr, "Usage: %s NAME [--hz N] [--seconds N] [--map] [--quiet]\n", program);
+}
+
+bool bit_set(const uint64_t *bits, long long cell) {
+    return (bits[cell >> 6] >> (cell & 63)) & 1;
+}
+
+void print_line(const struct SharedState *state) {
+    int i;
+    printf("tick %u level %u score %u lives %u/%u dots %u pacman %d,%d ghosts",
+           state->tick, state->level, state->score, state->lives, state->max_lives,
+           state->dots_remaining, state->pacman_row, state->pacman_col);
+    for (i = 0; i < NUM_GHOSTS; i++) {
+        printf(" %d,%d", state->ghosts[i].row, state->ghosts[i].col);
+    }
+    if (state->status & SHARED_STATE_WON) printf(" won");
+    if (state->status & SHARED_STATE_GAME_OVER) printf(" game over");
+    if (state->status & SHARED_STATE_EXITED) printf(" exited");
+    printf("\n");
+}
+
+// Draw the maze around pac-man from the top of the terminal
+void print_map(const struct SharedStateHeader *header, const struct SharedState *state,
+               const uint64_t *walls, const uint64_t *dots) {
+    static char line[WATCH_MAP_COLS + 1];
+    int rows = (int)header->rows < WATCH_MAP_ROWS ? (int)header->rows : WATCH_MAP_ROWS;
+    int cols = (int)header->cols < WATCH_MAP_COLS ? (int)header->cols : WATCH_MAP_COLS;
+    int top = state->pacman_row - rows / 2;
+    int left = state->pacman_col - cols / 2;
+    int r, c, g;
+
+    if (top > (int)header->rows - rows) top = (int)header->rows - rows;
+    if (left > (int)header->cols - cols) left = (int)header->cols - cols;
+    if (top < 0) top = 0;
+    if (left < 0) left = 0;
+
+    printf("\033[H");
+    print_line(state);
+    for (r = top; r < top + rows; r++) {
+        for (c = left; c < left + cols; c++) {
+            long long cell = (long long)r * header->cols + c;
+            line[c - left] = bit_set(walls, cell) ? '#' : bit_set(dots, cell) ? '.' : ' ';
+        }
+        for (g = 0; g < NUM_GHOSTS; g++) {
+            if (state->ghosts[g].row == r && state->ghosts[g].col >= left && state->ghosts[g].col < left + cols) {
+                line[state->ghosts[g].col - left] = 'G';
+            }
+        }
+        if (state->pacman_row == r && state->pacman_col >= left && state->pacman_col < left + cols) {
+            line[state->pacman_col - left] = 'C';
+        }
+        line[cols] = '\0';
+        printf("%s\033[K\n", line);
+    }
+    printf("\033[J");
+}
+
+int main(int argc, char **argv) {
+    const char *name = NULL;
+    int hz = 1000;
+    double seconds = 0;
+    bool map = false;
+    bool quiet = false;
+    struct SharedStateReader reader;
+    struct SharedState state;
+    struct WatchStats stats;
+    int i;
+
+    for (i = 1; i < argc; i++) {
+        const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+        bool ok = true;
+        if (strcmp(argv[i], "--hz") == 0 && value != NULL) {
+            hz = atoi(value);
+            ok = hz > 0;
+            i = i + 1;
+        } else if (strcmp(argv[i], "--seconds") == 0 && value != NULL) {
+            seconds = atof(value);
+            ok = seconds > 0;
+            i = i + 1;
+        } else if (strcmp(argv[i], "--map") == 0) {
+            map = true;
+        } else if (strcmp(argv[i], "--quiet") == 0) {
+            quiet = true;
+        } else if (argv[i][0] != '-' && name == NULL) {
+            name = argv[i];
+        } else {
+            ok = false;
+        }
+        if (ok == false) {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    if (name == NULL) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    // The game may not have started yet
+    long long start = platform_time_ns();
+    while (shared_state_open(&reader, name) == false) {
+        if (platform_time_ns() - start > 10000000000LL) {
+            fprintf(stderr, "Error: no game is shared as %s (start one with --share %s)\n", name, name);
+            return 1;
+        }
+        platform_sleep_ms(10);
+    }
+
+    const struct SharedStateHeader *header = reader.header;
+    uint64_t *walls = NULL;
+    uint64_t *dots = NULL;
+    if (map) {
+        walls = malloc((size_t)header->words * sizeof(uint64_t));
+        dots = malloc((size_t)header->words * sizeof(uint64_t));
+        if (walls == NULL || dots == NULL) {
+            fprintf(stderr, "Error: out of memory\n");
+            return 1;
+        }
+        printf("\033[2J");
+    }
+
+    memset(&stats, 0, sizeof(stats));
+    long long period = 1000000000LL / hz;
+    start = platform_time_ns();
+    long long next = start;
+    uint64_t last_update = 0;
+
+    while (seconds == 0 || platform_time_ns() - start < (long long)(seconds * 1e9)) {
+        stats.reads = stats.reads + 1;
+        if (shared_state_read(&reader, &state, walls, dots) == false) {
+            stats.failed = stats.failed + 1;
+        } else if (state.updates != last_update) {
+            long long age = platform_time_ns() - state.time_ns;
+            if (last_update != 0 && state.updates > last_update + 1) {
+                stats.missed = stats.missed + (unsigned long)(state.updates - last_update - 1);
+            }
+            last_update = state.updates;
+            stats.seen = stats.seen + 1;
+            stats.age_ns = stats.age_ns + age;
+            if (age > stats.max_age_ns) {
+                stats.max_age_ns = age;
+            }
+
+            if (quiet == false) {
+                if (map) {
+                    print_map(header, &state, walls, dots);
+                } else {
+                    print_line(&state);
+                }
+                fflush(stdout);
+            }
+            if (state.status & SHARED_STATE_EXITED) {
+                break;
+            }
+        }
+
+        // Keep to the rate on average: a late read is made up for by the
+        // next ones, unless it fell right behind
+        next = next + period;
+        long long now = platform_time_ns();
+        if (now - next > 10 * period) {
+            next = now;
+        }
+        if (next - now >= 1000000) {
+            platform_sleep_ms((int)((next - now) / 1000000));
+        }
+    }
+
+    double elapsed = (platform_time_ns() - start) / 1e9;
+    fprintf(stderr, "%lu reads in %.1f s (%.0f a second), %lu retried, %lu gave up\n",
+            stats.reads, elapsed, stats.reads / elapsed, (unsigned long)reader.retries, stats.failed);
+    fprintf(stderr, "%lu states seen, %lu missed; age when read: %.3f ms on average, %.3f ms at most\n",
+            stats.seen, stats.missed, stats.seen > 0 ? stats.age_ns / 1e6 / stats.seen : 0.0,
+            stats.max_age_ns / 1e6);
+
+    shared_state_close(&reader);
+    free(walls);
+    free(dots);
+    return 0;
+}